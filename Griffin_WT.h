@@ -8,16 +8,23 @@
 #endif
 
 /*===============================================================
-  External rspl headers (unchanged)
+  External rspl headers. Each header includes what it needs. HISE
+  builds the node as a single translation unit without linking the
+  rspl library, so the two rspl sources are compiled in here; CMake
+  builds (bench, tests, tools) link the rspl static library instead.
 ===============================================================*/
-#include "src\\griffinwave2\\rspl_big_arrays.cpp"
-#include "src\\griffinwave2\\rspl_big_arrays.h"
-#include "src\\griffinwave2\\rspl.h"
-#include "src\\griffinwave2\\rspl_basevoicestate.h"
-#include "src\\griffinwave2\\rspl_downsampler2flt.h"
-#include "src\\griffinwave2\\rspl_interp.h"
-#include "src\\griffinwave2\\rspl_mipmap.h"
-#include "src\\griffinwave2\\rspl_resamplerflt.h"
+#include "src/griffinwave2/rspl_big_arrays.cpp"
+#include "src/griffinwave2/rspl_rtaudit.cpp"
+#include "src/griffinwave2/rspl_rtaudit.h"
+#include "src/griffinwave2/rspl_cycleresample.h"
+#include "src/griffinwave2/rspl_framestore.h"
+#include "src/griffinwave2/rspl_spscqueue.h"
+#include "src/griffinwave2/rspl_eventqueue.h"
+#include "src/griffinwave2/rspl_paramhandoff.h"
+#include "src/griffinwave2/rspl_voicealloc.h"
+#include "src/griffinwave2/rspl_resamplerflt.h"
+#include "src/griffinwave2/rspl_mixbus.h"
+#include "src/griffinwave2/rspl_blocktimehist.h"
 
 #include <fstream>
 #include <iostream>
@@ -25,8 +32,14 @@
 #include <stdexcept>
 #include <streambuf>
 #include <vector>
+#include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <cstdlib>
 #include <cmath> // for sin()
 
@@ -43,6 +56,10 @@ namespace project
 
     /*===============================================================
       Griffin_WT
+      Voices are allocated inside the node: NV resamplers share one
+      mip map and one interpolator, and one process() call renders
+      them all into the shared 2x bus. The node is therefore not a
+      per-voice scriptnode node and must see every note event.
     ===============================================================*/
     template <int NV>
     struct Griffin_WT : public data::base
@@ -55,23 +72,91 @@ namespace project
         };
 
         static constexpr bool isModNode() { return false; }
-        static constexpr bool isPolyphonic() { return NV > 1; }
+        static constexpr bool isPolyphonic() { return false; }
+        static constexpr int  NumVoices = NV;
         static constexpr bool hasTail() { return false; }
-        static constexpr bool isSuspendedOnSilence() { return false; }
+        static constexpr bool isSuspendedOnSilence() { return true; }
         static constexpr int  getFixChannelAmount() { return 2; }
         static constexpr int  NumTables = 0;
         static constexpr int  NumSliderPacks = 0;
-        static constexpr int  NumAudioFiles = 0;
+        static constexpr int  NumAudioFiles = 1;
         static constexpr int  NumFilters = 0;
         static constexpr int  NumDisplayBuffers = 0;
 
         /*---------------------------------------------------------------
           Resampler, mip?map and wavetable fields
         ---------------------------------------------------------------*/
-        std::vector<float> wavetable;
-        rspl::MipMapFlt    mipMap;
+        std::vector<float> wavetable;  // raw frames, baseCycleLen each
+        rspl::FrameStore   frameStore; // unique frames, padded, plus frame map
+        rspl::MipMapFlt    mipMap;     // built from the unique frames only
         rspl::InterpPack   interpPack;
-        rspl::ResamplerFlt resampler;
+        rspl::MixBusFlt    mixBus;     // shared 2x bus, one downsampler per node
+
+        /* what the current mip map was built from; prepare() only
+           rebuilds when one of these changes. The content is compared
+           by hash, so an edit that forgets wavetableDirty still lands. */
+        static constexpr int nbrMipLevels = 12;
+        bool          wavetableDirty = true;   // set whenever the table content changes
+        uint64_t      builtHash = 0;           // hashWavetable() of the built content
+        const double* builtCoefs = nullptr;
+        long          builtLen = 0;
+        int           builtLevels = 0;
+
+        /*---------------------------------------------------------------
+          Voices - fixed capacity, no allocation after construction. The
+          allocator holds note and envelope state, resampler i renders
+          its voice i.
+        ---------------------------------------------------------------*/
+        static constexpr double attackMs = 1.0;
+        static constexpr double releaseMs = 10.0;
+        static constexpr double stealMs = 2.0;
+
+        rspl::ResamplerFlt    resamplers[NV];
+        rspl::VoiceAlloc<NV>  voiceAlloc;
+        double   sampleRate = 44100.0;
+        bool     pitchDirty = false;
+        bool     busSilent = true;       // downsampler flushed, nothing playing
+        int      silentRun = 0;          // samples rendered since the last voice ended
+
+        /* samples of decimator tail rendered after the last voice ends */
+        static constexpr int tailLen = 64;
+
+        /*---------------------------------------------------------------
+          Timestamped events - fixed capacity queue, consumed by process()
+        ---------------------------------------------------------------*/
+        static constexpr int maxQueuedEvents = 256;
+
+        /* events closer than this to the current split point are applied
+           at it, so dense automation does not degrade into tiny blocks */
+        static constexpr int minSubBlock = 16;
+
+        rspl::EventQueue<maxQueuedEvents> eventQueue;
+
+        /*---------------------------------------------------------------
+          Loaded wavetables - built on detached loader threads, handed
+          over to the audio thread with an atomic pointer swap. Only the
+          latest load publishes; older ones finish and drop their table.
+          Replaced tables go back through the retired queue and are
+          freed off the audio thread.
+        ---------------------------------------------------------------*/
+        struct TableSet
+        {
+            rspl::FrameStore frameStore;
+            rspl::MipMapFlt  mipMap;
+        };
+
+        static constexpr int maxLoadedFrames = 256;
+
+        TableSet*              loadedTable = nullptr;      // owned by the audio thread
+        TableSet*              fadingTable = nullptr;      // audio thread, still read by fading voices
+        int                    tableFadeLeft = 0;          // samples until fadingTable is unused
+        std::atomic<TableSet*> pendingTable { nullptr };   // loader -> audio thread
+        rspl::SpscQueue<TableSet*, 4> retiredTables;       // audio thread -> loaders
+        std::atomic<unsigned>  loadGen { 0 };              // latest load wins
+        std::mutex             loadLock;                   // loaders: publish and free
+        std::condition_variable loadersDone;
+        int                    loadersRunning = 0;         // under loadLock
+        long                   cycleLenHint = 0;           // 0 = guess from the file length
 
         /*---------------------------------------------------------------
           Wavetable specification
@@ -82,13 +167,52 @@ namespace project
         const long numSineCycles = 255;
         const long totalCycles = numSawCycles + numSineCycles;
         const long paddedCycleLen = baseCycleLen + halfCycle; // 3072
-        long       totalTableLen = totalCycles * paddedCycleLen;
+        long       totalTableLen = 0;   // unique frames only, set by the frame store
+
+        /* frames closer than this merge with the previous stored frame;
+           0 keeps exact deduplication only. Set it through
+           setFrameTolerance(), it takes effect on the next prepare(). */
+        float      frameTolerance = 0.0f;
 
         /*---------------------------------------------------------------
           Parameters
         ---------------------------------------------------------------*/
         float currentPitchParameter = 0.0f; // in octaves
         float volume = 1.0f;
+        float pan = 0.0f;                   // -1 left .. 1 right
+        float framePosParameter = 0.0f;     // 0 .. 1 across the table's frames
+
+        /*---------------------------------------------------------------
+          Output stage - gain and equal power pan, ramped linearly over
+          smoothLen samples and applied by the bus as it decimates
+        ---------------------------------------------------------------*/
+        static constexpr double smoothMs = 20.0;
+
+        int   smoothLen = 882;
+        float outGainL = 0.0f;
+        float outGainR = 0.0f;
+        float outTargetL = 0.0f;
+        float outTargetR = 0.0f;
+        float outStepL = 0.0f;
+        float outStepR = 0.0f;
+        int   outRampLeft = 0;
+
+        /*---------------------------------------------------------------
+          Parameter handoff - the members above belong to the audio
+          thread. Other threads write a per-parameter atomic slot (bursts
+          coalesce to the latest value) or, with a timestamp, push into
+          an SPSC queue drained at the start of each block, on the audio
+          thread only. Changes are numbered and the newest one wins, also
+          against a timestamped change carried over from an earlier
+          block (see rspl_paramhandoff.h).
+        ---------------------------------------------------------------*/
+        static constexpr int NumParameters = 4;
+
+        rspl::ParamHandoff<NumParameters, 256> params;
+
+        /* per-block process() durations, written by the audio thread
+           only; see getBlockTimes() */
+        rspl::BlockTimeHist blockTimes;
 
         /*---------------------------------------------------------------
           Ctor / prepare / reset
@@ -97,8 +221,112 @@ namespace project
 
         void prepare(PrepareSpecs specs)
         {
-            totalTableLen = totalCycles * paddedCycleLen;
-            wavetable.resize(totalTableLen);
+            if (static_cast<long>(wavetable.size()) != totalCycles * baseCycleLen)
+                generateWavetable();
+
+            const uint64_t hash = hashWavetable();
+            if (hash != builtHash)
+                wavetableDirty = true;
+
+            if (wavetableDirty)
+            {
+                frameStore.build(wavetable.data(), static_cast<int>(totalCycles),
+                                 baseCycleLen, halfCycle, frameTolerance);
+                totalTableLen = frameStore.get_table_len();
+            }
+
+            if (mipMapNeedsRebuild())
+            {
+                mipMap.init_sample(
+                    totalTableLen,
+                    rspl::InterpPack::get_len_pre(),
+                    rspl::InterpPack::get_len_post(),
+                    nbrMipLevels,
+                    rspl::MIP_MAP_FIR_COEF_ARR,
+                    rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
+                mipMap.fill_sample(frameStore.get_table(), totalTableLen);
+
+                wavetableDirty = false;
+                builtHash = hash;
+                builtCoefs = rspl::MIP_MAP_FIR_COEF_ARR;
+                builtLen = totalTableLen;
+                builtLevels = nbrMipLevels;
+            }
+
+            sampleRate = specs.sampleRate;
+            voiceAlloc.set_ramp_len(msToSamples(attackMs), msToSamples(releaseMs),
+                                    msToSamples(stealMs));
+            smoothLen = msToSamples(smoothMs);
+
+            /* slots only: the parameter queue has one consumer, the audio
+               thread, and prepare() may run elsewhere. Queued changes
+               wait for the next block. */
+            params.pull_slots([this](int i, float v) { applyParameter(i, v); });
+            updateOutputTargets(false);
+
+            /* rebinding only, the mip map is shared and may be reused */
+            for (auto& r : resamplers)
+            {
+                bindVoice(r);
+                r.clear_buffers();
+            }
+            voiceAlloc.kill_all();
+            busSilent = true;
+
+            /* all scratch is sized here; process() never allocates and
+               splits host blocks longer than blockSize */
+            mixBus.set_max_block_len(std::max(specs.blockSize, 1));
+            mixBus.clear_buffers();
+
+            /* the timer calibrates on first use, keep that off the audio
+               thread; old timings belong to the previous settings */
+            rspl::StopWatch::get_ns_per_clk();
+            blockTimes.request_reset();
+
+#if defined (RSPL_RT_AUDIT)
+            rspl::RtAudit::report("Griffin_WT");
+#endif
+        }
+
+        bool mipMapNeedsRebuild() const
+        {
+            return wavetableDirty
+                || !mipMap.is_ready()
+                || builtCoefs != rspl::MIP_MAP_FIR_COEF_ARR
+                || builtLen != totalTableLen
+                || builtLevels != nbrMipLevels;
+        }
+
+        void setFrameTolerance(float tolerance)
+        {
+            tolerance = std::max(tolerance, 0.0f);
+            if (tolerance != frameTolerance)
+            {
+                frameTolerance = tolerance;
+                wavetableDirty = true;
+            }
+        }
+
+        /* FNV-1a over the raw frames, one sample per step: a rebuild
+           costs tens of ms, the hash well under one */
+        uint64_t hashWavetable() const
+        {
+            uint64_t h = 14695981039346656037ULL;
+            for (float v : wavetable)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &v, sizeof(bits));
+                h = (h ^ bits) * 1099511628211ULL;
+            }
+            return h;
+        }
+
+        /* procedural content, deterministic: only run when the table
+           layout changes */
+        void generateWavetable()
+        {
+            wavetable.resize(totalCycles * baseCycleLen);
+            wavetableDirty = true;
 
             /* first cycle = saw */
             {
@@ -110,40 +338,221 @@ namespace project
                     wavetable[s] = static_cast<float>(headroom * saw_val);
                     saw_val += saw_step;
                 }
-                /* pad first half */
-                for (long s = 0; s < halfCycle; ++s)
-                    wavetable[baseCycleLen + s] = wavetable[s];
             }
 
-            /* remaining cycles = sine */
+            /* remaining cycles = sine; the frame store keeps one copy */
             for (long c = 1; c < totalCycles; ++c)
             {
-                long offset = c * paddedCycleLen;
+                long offset = c * baseCycleLen;
                 for (long s = 0; s < baseCycleLen; ++s)
                 {
                     const double phase = (2.0 * M_PI * s) / baseCycleLen;
                     wavetable[offset + s] = static_cast<float>(std::sin(phase));
                 }
-                for (long s = 0; s < halfCycle; ++s)
-                    wavetable[offset + baseCycleLen + s] = wavetable[offset + s];
             }
+        }
+
+        /*---------------------------------------------------------------
+          Table binding and loading
+        ---------------------------------------------------------------*/
+        ~Griffin_WT()
+        {
+            {
+                std::unique_lock<std::mutex> lock(loadLock);
+                ++loadGen;
+                loadersDone.wait(lock, [this]() { return loadersRunning == 0; });
+            }
+            freeRetiredTables();
+            delete pendingTable.exchange(nullptr);
+            delete fadingTable;
+            delete loadedTable;
+        }
+
+        const rspl::MipMapFlt& activeMipMap() const
+        {
+            return (loadedTable != nullptr) ? loadedTable->mipMap : mipMap;
+        }
+
+        const rspl::FrameStore& activeFrameStore() const
+        {
+            return (loadedTable != nullptr) ? loadedTable->frameStore : frameStore;
+        }
+
+        /* Frame parameter in frames of the active table */
+        float computeFramePos() const
+        {
+            const int nbrFrames = activeFrameStore().get_nbr_frames();
+            return framePosParameter * static_cast<float>(nbrFrames - 1);
+        }
+
+        /* the layout goes in while no table is bound, so the previous
+           table's frame map is never applied to the new one */
+        void bindVoice(rspl::ResamplerFlt& r)
+        {
+            const rspl::FrameStore& fs = activeFrameStore();
+            r.remove_sample();
+            r.set_frame_layout(fs.get_frame_stride(), fs.get_nbr_frames(), fs.get_frame_map());
+            r.set_frame_pos(computeFramePos());
+            r.set_sample(activeMipMap());
+            r.set_interp(interpPack);
+            r.set_force_ovrspl(mixBus.needs_ovrspl());
+        }
+
+        /* audio thread. Sounding voices keep pitch and phase and
+           crossfade to the new table (ResamplerFlt::swap_sample()), so
+           the previous set stays in fadingTable until the fade is over;
+           see advanceTableFade(). A new table waits for that. */
+        void takePendingTable()
+        {
+            if (fadingTable != nullptr || tableFadeLeft > 0)
+                return;
+            TableSet* t = pendingTable.exchange(nullptr, std::memory_order_acq_rel);
+            if (t == nullptr)
+                return;
+
+            fadingTable = loadedTable;   // null for the built-in table, never freed
+            loadedTable = t;
+            tableFadeLeft = rspl::BaseVoiceState::FADE_LEN;
+
+            const rspl::FrameStore& fs = t->frameStore;
+            const float framePos = computeFramePos();
+            for (int i = 0; i < NV; ++i)
+            {
+                rspl::ResamplerFlt& r = resamplers[i];
+                const rspl::VoiceSlot& s = voiceAlloc.use_slot(i);
+                if (s.is_active())
+                {
+                    r.swap_sample(t->mipMap, fs.get_frame_stride(), fs.get_nbr_frames(),
+                                  fs.get_frame_map(), framePos);
+                    r.set_pitch(computePitch(s._note));
+                }
+                else
+                {
+                    bindVoice(r);
+                }
+            }
+        }
+
+        /* audio thread, after n rendered samples */
+        void advanceTableFade(int n)
+        {
+            tableFadeLeft = std::max(tableFadeLeft - n, 0);
+            if (tableFadeLeft == 0 && fadingTable != nullptr && retiredTables.push(fadingTable))
+                fadingTable = nullptr;
+        }
+
+        /* HISE calls this off the audio thread with the decoded file.
+           The samples are mixed to mono and copied, then sliced and
+           mip mapped on the loader thread. An empty slot keeps the
+           current table. */
+        void setExternalData(const ExternalData& data, int index)
+        {
+            base::setExternalData(data, index);
+
+            if (data.dataType != ExternalData::DataType::AudioFile
+                || data.numSamples <= 0 || data.numChannels <= 0)
+                return;
+
+            std::vector<float> src(data.numSamples, 0.0f);
+            const float chanGain = 1.0f / static_cast<float>(data.numChannels);
+            for (int c = 0; c < data.numChannels; ++c)
+            {
+                block b;
+                data.referBlockTo(b, c);
+                for (int i = 0; i < data.numSamples; ++i)
+                    src[i] += chanGain * b[i];
+            }
+            startLoad(std::move(src));
+        }
+
+        /* cycle length of the next loaded file; 0 guesses it from the
+           file length, preferring 2048 (Serum, Vital) */
+        void setCycleLengthHint(long len) { cycleLenHint = std::max(len, 0L); }
+
+        /* Returns at once: the table is built on its own thread. A load
+           started later supersedes this one, which then drops its
+           result. A table published but not taken yet is replaced. */
+        void startLoad(std::vector<float>&& src)
+        {
+            const long cycleLen = (cycleLenHint > 0) ? cycleLenHint : guessCycleLen(static_cast<long>(src.size()));
+            unsigned gen;
+            {
+                std::lock_guard<std::mutex> lock(loadLock);
+                gen = ++loadGen;
+                ++loadersRunning;
+            }
+            std::thread([this, gen, cycleLen, s = std::move(src)]()
+            {
+                TableSet* t = buildTableSet(s, cycleLen);
+
+                std::lock_guard<std::mutex> lock(loadLock);
+                if (gen == loadGen.load())
+                    t = pendingTable.exchange(t, std::memory_order_acq_rel);
+                delete t;
+                freeRetiredTables();
+                --loadersRunning;
+                loadersDone.notify_all();
+            }).detach();
+        }
+
+        /* the retired queue has one consumer at a time: loaders hold
+           loadLock, the destructor runs after them */
+        void freeRetiredTables()
+        {
+            TableSet* t;
+            while (retiredTables.pop(t))
+                delete t;
+        }
+
+        static long guessCycleLen(long len)
+        {
+            for (long c : { 2048L, 1024L, 4096L, 512L, 256L })
+                if (len >= c && len % c == 0)
+                    return c;
+            return len;
+        }
+
+        static TableSet* buildTableSet(const std::vector<float>& src, long cycleLen)
+        {
+            const long len = static_cast<long>(src.size());
+            cycleLen = std::min(cycleLen, len);
+            const long nbrFrames = std::min<long>(maxLoadedFrames, len / cycleLen);
 
-            /* build mip?map */
-            mipMap.init_sample(
-                totalTableLen,
+            std::vector<float> raw(nbrFrames * baseCycleLen);
+            for (long f = 0; f < nbrFrames; ++f)
+                rspl::resample_cycle(&src[f * cycleLen], cycleLen, &raw[f * baseCycleLen], baseCycleLen);
+
+            TableSet* t = new TableSet;
+            t->frameStore.build(raw.data(), static_cast<int>(nbrFrames), baseCycleLen, halfCycle);
+            t->mipMap.init_sample(
+                t->frameStore.get_table_len(),
                 rspl::InterpPack::get_len_pre(),
                 rspl::InterpPack::get_len_post(),
-                12,
+                nbrMipLevels,
                 rspl::MIP_MAP_FIR_COEF_ARR,
                 rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
-            mipMap.fill_sample(wavetable.data(), totalTableLen);
+            t->mipMap.fill_sample(t->frameStore.get_table(), t->frameStore.get_table_len());
+            return t;
+        }
 
-            resampler.set_sample(mipMap);
-            resampler.set_interp(interpPack);
-            resampler.clear_buffers();
+        void reset()
+        {
+            for (auto& r : resamplers)
+                r.clear_buffers();
+            voiceAlloc.kill_all();
+            mixBus.clear_buffers();
+            busSilent = true;
+            eventQueue.clear();
         }
 
-        void reset() { resampler.clear_buffers(); }
+        /* true while no voice is sounding and the decimator tail has
+           been flushed; the output is exact silence */
+        bool isSilent() const { return busSilent && eventQueue.get_nbr_events() == 0; }
+
+        /* any thread: histogram of process() durations with the worst
+           block and when it happened. The reset lands on the next block. */
+        void getBlockTimes(rspl::BlockTimeHist::Snapshot& snap) const { blockTimes.read(snap); }
+        void resetBlockTimes() { blockTimes.request_reset(); }
 
         /*---------------------------------------------------------------
           process uses per?voice masking, no manual wrapping
@@ -157,18 +566,157 @@ namespace project
             float* R = block.getChannelPointer(1);
             const int n = data.getNumSamples();
 
-            const long fixedPitch = rspl::round_long(
-                currentPitchParameter * (1 << rspl::ResamplerFlt::NBR_BITS_PER_OCT));
-            resampler.set_pitch(fixedPitch);
+            rspl::BlockTimeHist::Scope timeScope(blockTimes, n);
+            rspl::RtAuditScope rtScope;
+
+            takePendingTable();
+            pullParameters();
+
+            /* split at event offsets, the rest waits for the next block */
+            eventQueue.process_block(n, minSubBlock,
+                [this](const rspl::TimedEvent& e) { applyEvent(e); },
+                [this, L, R](int pos, int len) { renderSegment(L + pos, R + pos, len); });
+            advanceTableFade(n);
+        }
+
+        void renderSegment(float* L, float* R, int n)
+        {
+            const int maxLen = static_cast<int>(mixBus.get_max_block_len());
+            for (int pos = 0; pos < n; pos += maxLen)
+                renderBlock(L + pos, R + pos, std::min(maxLen, n - pos));
+        }
+
+        void renderBlock(float* L, float* R, int n)
+        {
+            const bool anyActive = voiceAlloc.is_any_active();
+
+            /* nothing playing and the tail already flushed: skip the
+               bus entirely */
+            if (!anyActive && busSilent)
+            {
+                pitchDirty = false;
+                advanceOutputRamp(n);
+                std::memset(L, 0, sizeof(float) * n);
+                std::memset(R, 0, sizeof(float) * n);
+                return;
+            }
+
+            /* voices accumulate with their gain at 2x rate, the bus
+               decimates once for the whole node */
+            float* bus = mixBus.begin_block(n);
+            for (int i = 0; i < NV; ++i)
+            {
+                if (!voiceAlloc.use_slot(i).is_active())
+                    continue;
+                if (pitchDirty)
+                    resamplers[i].set_pitch(computePitch(voiceAlloc.use_slot(i)._note));
+                renderVoice(i, bus, n);
+            }
+            pitchDirty = false;
+            mixBus.end_block_stereo(L, R, n, outGainL, outStepL, outGainR, outStepR,
+                                    std::min(n, outRampLeft));
+            advanceOutputRamp(n);
+            updateSilence(anyActive, n);
+        }
+
+        /* tailLen samples after the last voice ended carry the decimator
+           tail; after them the bus state can be dropped */
+        void updateSilence(bool anyActive, int n)
+        {
+            if (anyActive)
+            {
+                busSilent = false;
+                silentRun = 0;
+            }
+            else if ((silentRun += n) >= tailLen)
+            {
+                mixBus.clear_buffers();
+                busSilent = true;
+            }
+        }
+
+        /*---------------------------------------------------------------
+          processFrame - one sample for frame-based containers. Voices
+          add their 2x pair to the bus frame and the bus decimates once,
+          without the per-call setup of the block path.
+        ---------------------------------------------------------------*/
+        template <typename FrameDataType>
+        void processFrame(FrameDataType& data)
+        {
+            rspl::RtAuditScope rtScope;
+
+            takePendingTable();
+            pullParameters();
+
+            /* containers deliver events at their sample, so whatever is
+               queued is due now */
+            eventQueue.flush([this](const rspl::TimedEvent& e) { applyEvent(e); });
+
+            const bool anyActive = voiceAlloc.is_any_active();
+
+            float out = 0.0f;
+            if (anyActive || !busSilent)
+            {
+                float* bus = mixBus.begin_frame();
+                for (int i = 0; i < NV; ++i)
+                {
+                    const rspl::VoiceSlot& s = voiceAlloc.use_slot(i);
+                    if (!s.is_active())
+                        continue;
+                    if (pitchDirty)
+                        resamplers[i].set_pitch(computePitch(s._note));
+                    resamplers[i].interpolate_sample_add_2x(bus, s._gain * s._env);
+                    if (voiceAlloc.advance(i, 1))
+                        startVoice(i);
+                }
+                out = mixBus.end_frame();
+                updateSilence(anyActive, 1);
+            }
+            pitchDirty = false;
+
+            data[0] = out * outGainL;
+            data[1] = out * outGainR;
+            advanceOutputRamp(1);
+            advanceTableFade(1);
+        }
 
-            std::vector<float> tmp(n, 0.0f);
-            resampler.interpolate_block(tmp.data(), n);
+        /* equal power pan, scaled so the centre keeps unity gain */
+        void updateOutputTargets(bool ramp)
+        {
+            const float angle = (pan + 1.0f) * static_cast<float>(M_PI * 0.25);
+            outTargetL = volume * std::sqrt(2.0f) * std::cos(angle);
+            outTargetR = volume * std::sqrt(2.0f) * std::sin(angle);
+            if (!ramp)
+            {
+                outGainL = outTargetL;
+                outGainR = outTargetR;
+                outRampLeft = 0;
+                outStepL = 0.0f;
+                outStepR = 0.0f;
+                return;
+            }
+            outRampLeft = smoothLen;
+            outStepL = (outTargetL - outGainL) / static_cast<float>(smoothLen);
+            outStepR = (outTargetR - outGainR) / static_cast<float>(smoothLen);
+        }
 
-            for (int i = 0; i < n; ++i)
+        void advanceOutputRamp(int n)
+        {
+            if (outRampLeft == 0)
+                return;
+            const int k = std::min(n, outRampLeft);
+            outRampLeft -= k;
+            if (outRampLeft == 0)
             {
-                float s = tmp[i] * volume;
-                L[i] = s;
-                R[i] = s;
+                outGainL = outTargetL;
+                outGainR = outTargetR;
+                outStepL = 0.0f;
+                outStepR = 0.0f;
+            }
+            else
+            {
+                outGainL += outStepL * k;
+                outGainR += outStepR * k;
             }
         }
 
@@ -178,8 +726,49 @@ namespace project
         template <int P>
         void setParameter(double v)
         {
-            if (P == 0)        volume = static_cast<float>(v);
-            else if (P == 1)   currentPitchParameter = static_cast<float>(v);
+            static_assert(P >= 0 && P < NumParameters, "parameter index out of range");
+            params.set(P, static_cast<float>(v));
+        }
+
+        /* sample accurate variant: takes effect offset samples into the
+           next process() call. One producer thread; when the queue is
+           full the change falls back to the coalescing slot. */
+        void setParameterAt(int index, double v, int offset)
+        {
+            if (index < 0 || index >= NumParameters)
+                return;
+            params.set_at(index, static_cast<float>(v), offset);
+        }
+
+        /* audio thread only, the sole consumer of the parameter queue:
+           slot values first, then the timestamped changes go through the
+           event queue. Whether a change is still the newest is decided
+           when it is applied, see applyEvent(). */
+        void pullParameters()
+        {
+            params.pull_slots([this](int i, float v) { applyParameter(i, v); });
+
+            rspl::ParamHandoff<NumParameters, 256>::Change c;
+            while (params.pop(c))
+                queueEvent({ c._offset, rspl::TimedEvent::Type_PARAM, c._index, c._val, c._seq });
+        }
+
+        void applyParameter(int index, float v)
+        {
+            if (index == 0)      { volume = v; updateOutputTargets(true); }
+            else if (index == 1) { currentPitchParameter = v; pitchDirty = true; }
+            else if (index == 2) { pan = v; updateOutputTargets(true); }
+            else if (index == 3) { setFramePos(v); }
+        }
+
+        /* voices morph between neighbour frames and crossfade to others,
+           see ResamplerFlt::set_frame_pos() */
+        void setFramePos(float v)
+        {
+            framePosParameter = std::min(std::max(v, 0.0f), 1.0f);
+            const float framePos = computeFramePos();
+            for (auto& r : resamplers)
+                r.set_frame_pos(framePos);
         }
 
         void createParameters(ParameterDataList& data)
@@ -196,10 +785,116 @@ namespace project
                 registerCallback<1>(p);
                 data.add(std::move(p));
             }
+            {
+                parameter::data p("Pan", { -1.0, 1.0, 0.01 });
+                p.setDefaultValue(0.0);
+                registerCallback<2>(p);
+                data.add(std::move(p));
+            }
+            {
+                parameter::data p("Frame", { 0.0, 1.0, 0.001 });
+                p.setDefaultValue(0.0);
+                registerCallback<3>(p);
+                data.add(std::move(p));
+            }
+        }
+
+        /*---------------------------------------------------------------
+          Voices
+        ---------------------------------------------------------------*/
+
+        /* 16.16 fixed point octaves relative to one table sample per
+           output sample; the Pitch parameter transposes in octaves */
+        long computePitch(int noteNumber) const
+        {
+            const double freq = 440.0 * std::pow(2.0, (noteNumber - 69) / 12.0);
+            const double octaves = std::log2(freq * baseCycleLen / sampleRate)
+                + currentPitchParameter;
+            const long maxPitch = (static_cast<long>(activeMipMap().get_nbr_tables())
+                << rspl::ResamplerFlt::NBR_BITS_PER_OCT) - 1;
+            const long pitch = rspl::round_long(
+                octaves * (1 << rspl::ResamplerFlt::NBR_BITS_PER_OCT));
+            return std::min(pitch, maxPitch);
+        }
+
+        int msToSamples(double ms) const
+        {
+            return std::max(1, static_cast<int>(ms * 0.001 * sampleRate + 0.5));
         }
 
-        void handleHiseEvent(HiseEvent& e) {}
-        SN_EMPTY_PROCESS_FRAME;
+        /* the allocator has set up the note and its attack */
+        void startVoice(int i)
+        {
+            rspl::ResamplerFlt& r = resamplers[i];
+            r.set_pitch(computePitch(voiceAlloc.use_slot(i)._note));
+            r.clear_buffers();
+            r.set_playback_pos(0);
+        }
+
+        /* splits the block at ramp ends so every segment is a single
+           linear gain ramp */
+        void renderVoice(int i, float* bus, int n)
+        {
+            const rspl::VoiceSlot& s = voiceAlloc.use_slot(i);
+            rspl::ResamplerFlt& r = resamplers[i];
+            int pos = 0;
+            while (pos < n && s.is_active())
+            {
+                const float g = s._gain;
+                if (s._stage == rspl::VoiceSlot::Stage_SUSTAIN)
+                {
+                    r.interpolate_block_add_2x(bus + pos * 2, n - pos, g, 0.0f);
+                    return;
+                }
+                const int len = std::min(n - pos, s._env_left);
+                r.interpolate_block_add_2x(bus + pos * 2, len, g * s._env, g * s._env_step);
+                pos += len;
+                if (voiceAlloc.advance(i, len))
+                    startVoice(i);
+            }
+        }
+
+        /*---------------------------------------------------------------
+          Events
+        ---------------------------------------------------------------*/
+
+        /* a full queue applies the event right away */
+        void queueEvent(const rspl::TimedEvent& e)
+        {
+            if (!eventQueue.push(e))
+                applyEvent(e);
+        }
+
+        void applyEvent(const rspl::TimedEvent& e)
+        {
+            switch (e._type)
+            {
+            case rspl::TimedEvent::Type_NOTE_ON:  noteOn(e._index, e._val);          break;
+            case rspl::TimedEvent::Type_NOTE_OFF: voiceAlloc.note_off(e._index);     break;
+            case rspl::TimedEvent::Type_PARAM:
+                if (params.accept(e._index, e._seq))
+                    applyParameter(e._index, e._val);
+                break;
+            }
+        }
+
+        void handleHiseEvent(HiseEvent& e)
+        {
+            rspl::RtAuditScope rtScope;
+
+            const int offset = static_cast<int>(e.getTimeStamp());
+            if (e.isNoteOn())
+                queueEvent({ offset, rspl::TimedEvent::Type_NOTE_ON, e.getNoteNumber(), e.getFloatVelocity(), 0 });
+            else if (e.isNoteOff())
+                queueEvent({ offset, rspl::TimedEvent::Type_NOTE_OFF, e.getNoteNumber(), 0.0f, 0 });
+        }
+
+        void noteOn(int note, float vel)
+        {
+            const int i = voiceAlloc.note_on(note, vel);
+            if (i >= 0)
+                startVoice(i);
+        }
     };
 
 } // namespace project
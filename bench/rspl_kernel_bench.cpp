@@ -0,0 +1,494 @@
+/******************************************************************************
+    rspl_kernel_bench.cpp - Kernel microbenchmarks for the rspl library
+    No JUCE/HISE dependency. Times the inner kernels in isolation with
+    rspl::StopWatch and prints one CSV line per measurement:
+
+        layout,kernel,variant,pitch_oct,level,block,clk_per_spl,ns_per_spl,ns_median,
+        ipc,ins_per_spl,l1d_miss_per_spl,llc_miss_per_spl,br_miss_per_spl
+
+    clk_per_spl and ns_per_spl are the best of several repetitions, so
+    they track the kernel rather than scheduler noise; ns_median shows
+    how noisy the machine was. Nanoseconds come from the calibrated
+    StopWatch and compare across machines.
+
+    layout is the wavetable the kernel reads. The single-frame kernels
+    run on "morph16" only; frame_sweep and mip_map_build run on each
+    layout, from a 16-frame table that fits in L2 up to 256 distinct
+    frames (about 3 MB at level 0).
+
+    With --perf, the last five columns come from the hardware counters
+    (rspl_perfcounters.h, Linux only), summed over all repetitions and
+    given per output sample, so they do not depend on instruction count
+    the way per-instruction rates do. Columns stay empty when a counter
+    is not available. Build from the repository root:
+
+        g++ -O2 -I. bench/rspl_kernel_bench.cpp rspl_big_arrays.cpp -o rspl_kernel_bench
+        ./rspl_kernel_bench [--perf]
+******************************************************************************/
+
+#include "rspl_framestore.h"
+#include "rspl_resamplerflt.h"
+#include "rspl_unison.h"
+#include "rspl_stopwatch.h"
+#include "rspl_perfcounters.h"
+
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+
+    const int  NBR_REPEATS = 9;
+    const long MIN_SPL_PER_RUN = 16384;  // amortises the timer reads
+    const long BASE_CYCLE_LEN = 2048;
+    const int  NBR_LEVELS = 12;
+
+    /* keeps results alive so the optimiser cannot drop the work */
+    volatile float sink = 0;
+
+    /* opened by --perf, closed otherwise */
+    rspl::PerfCounters perf;
+
+    /* per-run clocks per sample, and the counters summed over all runs
+       per sample, -1 when unknown */
+    class Result
+    {
+    public:
+        rspl::StopWatchStats _clk;
+        double  _cnt_arr [rspl::PerfCounters::Event_NBR_ELT];
+    };
+
+    /* the wavetable kernels read from */
+    class Layout
+    {
+    public:
+        const char*      _name;
+        rspl::FrameStore _store;
+        rspl::MipMapFlt  _mip_map;
+    };
+
+    void print_cnt(double val, const char* fmt)
+    {
+        printf(",");
+        if (val >= 0)
+        {
+            printf(fmt, val);
+        }
+    }
+
+    void print_result(const char* layout, const char* kernel, const char* variant, double pitch_oct, int level, long block, const Result& res)
+    {
+        typedef rspl::PerfCounters PC;
+        const double ns_per_clk = rspl::StopWatch::get_ns_per_clk();
+        printf("%s,%s,%s,%.2f,%d,%ld,%.3f,%.4f,%.4f", layout, kernel, variant, pitch_oct, level, block,
+            res._clk.get_min(), res._clk.get_min() * ns_per_clk, res._clk.get_median() * ns_per_clk);
+
+        const double ins = res._cnt_arr[PC::Event_INSTR];
+        const double cyc = res._cnt_arr[PC::Event_CYCLES];
+        print_cnt((ins >= 0 && cyc > 0) ? ins / cyc : -1, "%.3f");
+        print_cnt(ins, "%.3f");
+        print_cnt(res._cnt_arr[PC::Event_L1D_MISS], "%.5f");
+        print_cnt(res._cnt_arr[PC::Event_LLC_MISS], "%.5f");
+        print_cnt(res._cnt_arr[PC::Event_BRANCH_MISS], "%.5f");
+        printf("\n");
+    }
+
+    /* NBR_REPEATS runs, in clocks per sample. fnc processes
+       nbr_spl_per_call samples and is called enough times per run to
+       cover MIN_SPL_PER_RUN samples. The counters bracket the stop
+       watch, so their syscalls stay out of the timings. */
+    template <class F>
+    Result measure(long nbr_spl_per_call, F fnc)
+    {
+        typedef rspl::PerfCounters PC;
+        const long nbr_calls = std::max(1L, MIN_SPL_PER_RUN / nbr_spl_per_call);
+        rspl::StopWatch sw;
+        Result res;
+        res._clk.reserve(NBR_REPEATS);
+        for (int e = 0; e < PC::Event_NBR_ELT; ++e)
+        {
+            res._cnt_arr[e] = perf.is_available(static_cast<PC::Event>(e)) ? 0 : -1;
+        }
+
+        fnc();                                  // warm caches
+        for (int r = 0; r < NBR_REPEATS; ++r)
+        {
+            perf.start();
+            sw.start();
+            for (long c = 0; c < nbr_calls; ++c)
+            {
+                fnc();
+            }
+            sw.stop();
+            perf.stop();
+            res._clk.add(sw.get_clk_per_op(nbr_spl_per_call, nbr_calls));
+
+            for (int e = 0; e < PC::Event_NBR_ELT; ++e)
+            {
+                const double cnt = perf.get(static_cast<PC::Event>(e));
+                res._cnt_arr[e] = (res._cnt_arr[e] >= 0 && cnt >= 0) ? res._cnt_arr[e] + cnt : -1;
+            }
+        }
+
+        const double nbr_spl = static_cast<double>(nbr_spl_per_call) * nbr_calls * NBR_REPEATS;
+        for (int e = 0; e < PC::Event_NBR_ELT; ++e)
+        {
+            if (res._cnt_arr[e] >= 0)
+            {
+                res._cnt_arr[e] /= nbr_spl;
+            }
+        }
+        return res;
+    }
+
+    enum Content { Content_MORPH = 0, Content_GRIFFIN, Content_DISTINCT };
+
+    /* one cycle per frame, deduplicated and padded.
+       morph: saw-to-sine morph.
+       griffin: same as Griffin_WT::generateWavetable(), one saw and the
+       rest sines, which dedup to two slots.
+       distinct: saw-to-sine morph with a per-frame phase shift, so no
+       two frames are equal, as a loaded wavetable would be. */
+    void build_table(Layout& layout, const char* name, Content content, int nbr_frames)
+    {
+        layout._name = name;
+        std::vector<float> raw(nbr_frames * BASE_CYCLE_LEN);
+        for (int f = 0; f < nbr_frames; ++f)
+        {
+            const double mix = static_cast<double>(f) / std::max(1, nbr_frames - 1);
+            const double shift = (content == Content_DISTINCT) ? 0.01 * f : 0;
+            for (long s = 0; s < BASE_CYCLE_LEN; ++s)
+            {
+                const double ph = static_cast<double>(s) / BASE_CYCLE_LEN;
+                double val;
+                if (content == Content_GRIFFIN)
+                {
+                    val = (f == 0) ? 0.8 * (-1.0 + 2.0 * s / (BASE_CYCLE_LEN - 1.0)) : sin(2 * rspl::PI * ph);
+                }
+                else
+                {
+                    const double saw = 2 * ph - 1;
+                    const double sine = sin(2 * rspl::PI * (ph + shift));
+                    val = 0.8 * ((1 - mix) * saw + mix * sine);
+                }
+                raw[f * BASE_CYCLE_LEN + s] = static_cast<float>(val);
+            }
+        }
+
+        rspl::FrameStore& store = layout._store;
+        rspl::MipMapFlt& mip_map = layout._mip_map;
+        store.build(&raw[0], nbr_frames, BASE_CYCLE_LEN, BASE_CYCLE_LEN / 2);
+
+        mip_map.init_sample(
+            store.get_table_len(),
+            rspl::InterpPack::get_len_pre(),
+            rspl::InterpPack::get_len_post(),
+            NBR_LEVELS,
+            rspl::MIP_MAP_FIR_COEF_ARR,
+            rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
+        mip_map.fill_sample(store.get_table(), store.get_table_len());
+    }
+
+    /* same setup as ResamplerFlt::reset_pitch_cur_voice() */
+    void init_voice(rspl::BaseVoiceState& v, const rspl::MipMapFlt& mip_map, long pitch)
+    {
+        v._table = (pitch >= 0) ? static_cast<int>(pitch >> rspl::ResamplerFlt::NBR_BITS_PER_OCT) : 0;
+        v._table_len = mip_map.get_lev_len(v._table);
+        v._ovrspl_flag = (pitch >= 0);
+        v._cycle_len = static_cast<rspl::UInt32>(BASE_CYCLE_LEN >> v._table);
+        v._cycle_mask = v._cycle_len - 1U;
+        v._table_ptr = mip_map.use_table(v._table);
+        v._table_nxt_ptr = 0;
+        v._morph = 0;
+        v._morph_step = 0;
+        v._pos._all = 0;
+        v.compute_step(pitch);
+    }
+
+    /*------------------------------ kernels --------------------------------*/
+    template <class IF>
+    void bench_interp_flt(const Layout& layout, const char* variant, const double imp_ptr[], long block)
+    {
+        IF interp;
+        interp.set_impulse(imp_ptr);
+        const float* table_ptr = layout._mip_map.use_table(0);
+        const rspl::UInt32 mask = static_cast<rspl::UInt32>(BASE_CYCLE_LEN - 1);
+        const rspl::Int64 step = (static_cast<rspl::Int64>(1) << 32) * 13 / 10;
+
+        const Result clk_unmasked = measure(block, [&]()
+        {
+            rspl::Fixed3232 pos;
+            pos._all = 0;
+            float acc = 0;
+            for (long i = 0; i < block; ++i)
+            {
+                const long idx = static_cast<long>(pos._part._msw & mask);
+                acc += interp.interpolate(table_ptr + idx + 64, pos._part._lsw);
+                pos._all += step;
+            }
+            sink = acc;
+        });
+        print_result(layout._name, "interpolate", variant, 0, 0, block, clk_unmasked);
+
+        const Result clk_masked = measure(block, [&]()
+        {
+            rspl::Fixed3232 pos;
+            pos._all = 0;
+            float acc = 0;
+            for (long i = 0; i < block; ++i)
+            {
+                acc += interp.interpolate_masked(table_ptr, pos._part._msw, pos._part._lsw, mask);
+                pos._all += step;
+            }
+            sink = acc;
+        });
+        print_result(layout._name, "interpolate_masked", variant, 0, 0, block, clk_masked);
+    }
+
+    void bench_interp_pack(const Layout& layout, const rspl::InterpPack& pack, double pitch_oct, long block)
+    {
+        const long pitch = static_cast<long>(pitch_oct * (1L << rspl::ResamplerFlt::NBR_BITS_PER_OCT));
+        rspl::BaseVoiceState v;
+        init_voice(v, layout._mip_map, pitch);
+        std::vector<float> buf(block * 2);
+
+        if (v._ovrspl_flag)
+        {
+            /* two interpolated samples per output sample */
+            const Result clk = measure(block, [&]() { pack.interp_ovrspl(&buf[0], block * 2, v); sink = buf[0]; });
+            print_result(layout._name, "interp_ovrspl", "pack", pitch_oct, v._table, block, clk);
+        }
+        else
+        {
+            const Result clk = measure(block, [&]() { pack.interp_norm(&buf[0], block, v); sink = buf[0]; });
+            print_result(layout._name, "interp_norm", "pack", pitch_oct, v._table, block, clk);
+        }
+    }
+
+    void bench_downsampler(const Layout& layout, long block)
+    {
+        rspl::Downsampler2Flt dwnspl;
+        dwnspl.set_coefs(rspl::DOWNSAMPLER_COEF_ARR);
+        std::vector<float> src(block * 2);
+        std::vector<float> dest(block);
+        for (long i = 0; i < block * 2; ++i)
+        {
+            src[i] = static_cast<float>(sin(i * 0.01));
+        }
+
+        const Result clk_dwn = measure(block, [&]() { dwnspl.downsample_block(&dest[0], &src[0], block); sink = dest[0]; });
+        print_result(layout._name, "downsample_block", "scalar", 0, 0, block, clk_dwn);
+
+        const Result clk_ph = measure(block, [&]() { dwnspl.phase_block(&dest[0], &src[0], block); sink = dest[0]; });
+        print_result(layout._name, "phase_block", "scalar", 0, 0, block, clk_ph);
+    }
+
+    /* N interleaved streams, timed per sample per lane so the rows line
+       up with the scalar ones */
+    template <int N>
+    void bench_downsampler_lanes(const Layout& layout, long block)
+    {
+        rspl::Downsampler2FltN<N> dwnspl;
+        dwnspl.set_coefs(rspl::DOWNSAMPLER_COEF_ARR);
+        std::vector<float> src(block * 2 * N);
+        std::vector<float> dest(block * N);
+        for (long i = 0; i < block * 2 * N; ++i)
+        {
+            src[i] = static_cast<float>(sin(i * 0.01));
+        }
+        char variant[16];
+        snprintf(variant, sizeof(variant), "lanes%d", N);
+
+        const Result clk_dwn = measure(block * N, [&]() { dwnspl.downsample_block(&dest[0], &src[0], block); sink = dest[0]; });
+        print_result(layout._name, "downsample_block", variant, 0, 0, block, clk_dwn);
+
+        const Result clk_ph = measure(block * N, [&]() { dwnspl.phase_block(&dest[0], &src[0], block); sink = dest[0]; });
+        print_result(layout._name, "phase_block", variant, 0, 0, block, clk_ph);
+    }
+
+    /* fade_block() is private: force a level change before every render so
+       the whole FADE_LEN block goes through the crossfade */
+    void bench_fade(const Layout& layout, const rspl::InterpPack& pack, double pitch_oct)
+    {
+        const long block = rspl::BaseVoiceState::FADE_LEN;
+        const long pitch_a = static_cast<long>(pitch_oct * (1L << rspl::ResamplerFlt::NBR_BITS_PER_OCT));
+        const long pitch_b = pitch_a + (1L << rspl::ResamplerFlt::NBR_BITS_PER_OCT);
+        rspl::ResamplerFlt rspl;
+        rspl.set_sample(layout._mip_map);
+        rspl.set_interp(pack);
+        rspl.set_pitch(pitch_a);
+        std::vector<float> dest(block);
+        bool toggle = false;
+
+        const long nbr_blocks = 64;
+        const Result clk = measure(block * nbr_blocks, [&]()
+        {
+            for (long b = 0; b < nbr_blocks; ++b)
+            {
+                toggle = !toggle;
+                rspl.set_pitch(toggle ? pitch_b : pitch_a);
+                rspl.interpolate_block(&dest[0], block);
+            }
+            sink = dest[0];
+        });
+        const int level = (pitch_a >= 0) ? static_cast<int>(pitch_a >> rspl::ResamplerFlt::NBR_BITS_PER_OCT) : 0;
+        print_result(layout._name, "fade_block", "resampler", pitch_oct, level, block, clk);
+    }
+
+    /* a detuned stack, stereo out, per output sample of the whole stack */
+    void bench_unison(const Layout& layout, const rspl::InterpPack& pack, double pitch_oct, int nbr_voices, long block)
+    {
+        const long pitch = static_cast<long>(pitch_oct * (1L << rspl::ResamplerFlt::NBR_BITS_PER_OCT));
+        rspl::UnisonFlt unison;
+        unison.set_sample(layout._mip_map);
+        unison.set_interp(pack);
+        unison.set_nbr_voices(nbr_voices);
+        unison.set_detune(1L << (rspl::UnisonFlt::NBR_BITS_PER_OCT - 5));  // 37.5 cents
+        unison.set_spread(0.7f);
+        unison.set_pitch(pitch);
+        std::vector<float> dest_l(block);
+        std::vector<float> dest_r(block);
+
+        const Result clk = measure(block, [&]()
+        {
+            unison.interpolate_block(&dest_l[0], &dest_r[0], block);
+            sink = dest_l[0] + dest_r[0];
+        });
+        char variant[16];
+        snprintf(variant, sizeof(variant), "k%d", nbr_voices);
+        const int level = (pitch >= 0) ? static_cast<int>(pitch >> rspl::ResamplerFlt::NBR_BITS_PER_OCT) : 0;
+        print_result(layout._name, "unison", variant, pitch_oct, level, block, clk);
+    }
+
+    /* a voice sweeping the frame position, a quarter frame per block
+       and around the table, so it keeps moving through the layout: the
+       case where the table size shows in the cache misses */
+    void bench_frame_sweep(const Layout& layout, const rspl::InterpPack& pack, double pitch_oct, long block)
+    {
+        const long pitch = static_cast<long>(pitch_oct * (1L << rspl::ResamplerFlt::NBR_BITS_PER_OCT));
+        const rspl::FrameStore& store = layout._store;
+        const int last = store.get_nbr_frames() - 1;
+        rspl::ResamplerFlt rspl;
+        rspl.set_sample(layout._mip_map);
+        rspl.set_interp(pack);
+        rspl.set_frame_layout(store.get_frame_stride(), store.get_nbr_frames(), store.get_frame_map());
+        rspl.set_pitch(pitch);
+        std::vector<float> dest(block);
+        float frame_pos = 0;
+
+        const Result clk = measure(block, [&]()
+        {
+            frame_pos += 0.25f;
+            if (frame_pos >= last)
+            {
+                frame_pos = 0;
+            }
+            rspl.set_frame_pos(frame_pos);
+            rspl.interpolate_block(&dest[0], block);
+            sink = dest[0];
+        });
+        const int level = (pitch >= 0) ? static_cast<int>(pitch >> rspl::ResamplerFlt::NBR_BITS_PER_OCT) : 0;
+        print_result(layout._name, "frame_sweep", "resampler", pitch_oct, level, block, clk);
+    }
+
+    void bench_mip_map_build(const Layout& layout)
+    {
+        const rspl::FrameStore& store = layout._store;
+        rspl::MipMapFlt mip_map;
+        const long len = store.get_table_len();
+        const Result clk = measure(len, [&]()
+        {
+            mip_map.init_sample(
+                len,
+                rspl::InterpPack::get_len_pre(),
+                rspl::InterpPack::get_len_post(),
+                NBR_LEVELS,
+                rspl::MIP_MAP_FIR_COEF_ARR,
+                rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
+            mip_map.fill_sample(store.get_table(), len);
+        });
+        print_result(layout._name, "mip_map_build", "full", 0, NBR_LEVELS, len, clk);
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const bool perf_flag = (argc > 1 && strcmp(argv[1], "--perf") == 0);
+    if (argc > 2 || (argc == 2 && !perf_flag))
+    {
+        printf("usage: %s [--perf]\n", argv[0]);
+        return 2;
+    }
+
+    rspl::InterpPack pack;
+    Layout layout_arr[3];
+    build_table(layout_arr[0], "morph16", Content_MORPH, 16);
+    build_table(layout_arr[1], "griffin256", Content_GRIFFIN, 256);
+    build_table(layout_arr[2], "distinct256", Content_DISTINCT, 256);
+    const Layout& layout = layout_arr[0];
+
+    if (perf_flag && !perf.open())
+    {
+        fprintf(stderr, "perf counters not available: %s\n", strerror(perf.get_err()));
+    }
+
+    printf("# ns_per_clk=%.6f clk_invariant=%d perf=%d\n",
+        rspl::StopWatch::get_ns_per_clk(), rspl::StopWatch::is_clk_invariant() ? 1 : 0, perf.is_open() ? 1 : 0);
+    printf("layout,kernel,variant,pitch_oct,level,block,clk_per_spl,ns_per_spl,ns_median,"
+           "ipc,ins_per_spl,l1d_miss_per_spl,llc_miss_per_spl,br_miss_per_spl\n");
+
+    const long block_arr[] = { 16, 64, 256, 1024 };
+    const double pitch_arr[] = { -2.0, -0.5, 0.0, 1.0, 3.0, 6.0, 9.0 };
+
+    for (long block : block_arr)
+    {
+        bench_interp_flt<rspl::InterpFlt<2> >(layout, "1x", rspl::FIR_1X_COEF_ARR, block);
+        bench_interp_flt<rspl::InterpFlt<1> >(layout, "2x", rspl::FIR_2X_COEF_ARR, block);
+    }
+
+    for (double pitch_oct : pitch_arr)
+    {
+        for (long block : block_arr)
+        {
+            bench_interp_pack(layout, pack, pitch_oct, block);
+        }
+    }
+
+    for (long block : block_arr)
+    {
+        bench_downsampler(layout, block);
+        bench_downsampler_lanes<4>(layout, block);
+        bench_downsampler_lanes<8>(layout, block);
+    }
+
+    for (double pitch_oct : { -1.0, 0.0, 4.0 })
+    {
+        bench_fade(layout, pack, pitch_oct);
+    }
+
+    for (double pitch_oct : { -1.0, 0.0 })
+    {
+        for (int nbr_voices : { 1, 4, 8, 16 })
+        {
+            bench_unison(layout, pack, pitch_oct, nbr_voices, 64);
+        }
+    }
+
+    for (const Layout& sweep_layout : layout_arr)
+    {
+        for (double pitch_oct : { -1.0, 0.0, 3.0 })
+        {
+            for (long block : { 64L, 256L })
+            {
+                bench_frame_sweep(sweep_layout, pack, pitch_oct, block);
+            }
+        }
+        bench_mip_map_build(sweep_layout);
+    }
+
+    return 0;
+}
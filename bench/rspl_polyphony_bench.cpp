@@ -0,0 +1,216 @@
+/******************************************************************************
+    rspl_polyphony_bench.cpp - End-to-end polyphony scaling benchmark
+    No JUCE/HISE dependency. Renders 1 .. 256 voices against one shared
+    mip map through the same path as Griffin_WT: every voice accumulates
+    into a MixBusFlt with interpolate_block_add_2x() and the bus decimates
+    once per block. Each voice gets a random note, frame position, gain,
+    vibrato and frame sweep; the modulation is applied once per block,
+    like parameter changes in the node.
+
+    Prints one CSV line per (sample rate, voice count):
+
+        rate,voices,block,rtf,ns_per_voice_spl,max_voices
+
+    rtf is render time over audio time for SECONDS of audio (1 = one
+    core fully busy). max_voices is the voice count that would use
+    the CPU budget, extrapolated from that run; the last line of each
+    rate (256 voices) is the figure to plan with. Build from the
+    repository root:
+
+        g++ -O2 -I. bench/rspl_polyphony_bench.cpp rspl_big_arrays.cpp -o rspl_polyphony_bench
+        ./rspl_polyphony_bench [budget=0.7] [block=64] [seconds=1]
+******************************************************************************/
+
+#include "rspl_framestore.h"
+#include "rspl_resamplerflt.h"
+#include "rspl_mixbus.h"
+#include "rspl_stopwatch.h"
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+
+    const long BASE_CYCLE_LEN = 2048;
+    const long NBR_FRAMES = 64;
+    const int  NBR_LEVELS = 12;
+    const int  MAX_VOICES = 256;
+
+    /* keeps results alive so the optimiser cannot drop the work */
+    volatile float sink = 0;
+
+    /* xorshift32, fixed seed so every run plays the same voices */
+    class Rnd
+    {
+    public:
+        explicit Rnd(unsigned int seed) : _state(seed) {}
+        double gen(double lo, double hi)
+        {
+            _state ^= _state << 13;
+            _state ^= _state >> 17;
+            _state ^= _state << 5;
+            return lo + (hi - lo) * (_state / 4294967296.0);
+        }
+    private:
+        unsigned int _state;
+    };
+
+    /* saw-to-square-to-sine morph, one cycle per frame */
+    void build_table(rspl::FrameStore& store, rspl::MipMapFlt& mip_map)
+    {
+        std::vector<float> raw(NBR_FRAMES * BASE_CYCLE_LEN);
+        for (long f = 0; f < NBR_FRAMES; ++f)
+        {
+            const double mix = static_cast<double>(f) / (NBR_FRAMES - 1);
+            for (long s = 0; s < BASE_CYCLE_LEN; ++s)
+            {
+                const double ph = static_cast<double>(s) / BASE_CYCLE_LEN;
+                const double saw = 2 * ph - 1;
+                const double sqr = (ph < 0.5) ? 1 : -1;
+                const double sine = sin(2 * rspl::PI * ph);
+                const double val = (mix < 0.5)
+                    ? (1 - 2 * mix) * saw + 2 * mix * sqr
+                    : (2 - 2 * mix) * sqr + (2 * mix - 1) * sine;
+                raw[f * BASE_CYCLE_LEN + s] = static_cast<float>(0.5 * val);
+            }
+        }
+        store.build(&raw[0], NBR_FRAMES, BASE_CYCLE_LEN, BASE_CYCLE_LEN / 2);
+
+        mip_map.init_sample(
+            store.get_table_len(),
+            rspl::InterpPack::get_len_pre(),
+            rspl::InterpPack::get_len_post(),
+            NBR_LEVELS,
+            rspl::MIP_MAP_FIR_COEF_ARR,
+            rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
+        mip_map.fill_sample(store.get_table(), store.get_table_len());
+    }
+
+    class Voice
+    {
+    public:
+        rspl::ResamplerFlt _rspl;
+        double  _pitch_oct;     // at the current sample rate
+        double  _gain;
+        double  _vib_depth;     // octaves
+        double  _vib_phase;
+        double  _vib_inc;       // per block
+        double  _frame_center;
+        double  _frame_depth;
+        double  _frame_phase;
+        double  _frame_inc;     // per block
+    };
+
+    /* random note 40 Hz .. 2 kHz, vibrato up to half a semitone at
+       0.5 .. 7 Hz, frame sweep at 0.05 .. 1 Hz */
+    void init_voice(Voice& v, Rnd& rnd, const rspl::FrameStore& store, const rspl::MipMapFlt& mip_map,
+        const rspl::InterpPack& pack, double rate, long block)
+    {
+        const double freq = 40 * pow(2.0, rnd.gen(0, log(2000.0 / 40) / log(2.0)));
+        v._pitch_oct = log(freq * BASE_CYCLE_LEN / rate) / log(2.0);
+        v._gain = rnd.gen(0.1, 1.0) / MAX_VOICES;
+        v._vib_depth = rnd.gen(0, 0.5 / 12);
+        v._vib_phase = rnd.gen(0, 2 * rspl::PI);
+        v._vib_inc = 2 * rspl::PI * rnd.gen(0.5, 7) * block / rate;
+        v._frame_center = rnd.gen(0, NBR_FRAMES - 1);
+        v._frame_depth = rnd.gen(0, NBR_FRAMES / 4);
+        v._frame_phase = rnd.gen(0, 2 * rspl::PI);
+        v._frame_inc = 2 * rspl::PI * rnd.gen(0.05, 1) * block / rate;
+
+        v._rspl.set_sample(mip_map);
+        v._rspl.set_interp(pack);
+        v._rspl.set_frame_layout(store.get_frame_stride(), store.get_nbr_frames(), store.get_frame_map());
+    }
+
+    long to_pitch(double pitch_oct)
+    {
+        return static_cast<long>(floor(pitch_oct * (1L << rspl::ResamplerFlt::NBR_BITS_PER_OCT) + 0.5));
+    }
+
+    void modulate(Voice& v)
+    {
+        v._rspl.set_pitch(to_pitch(v._pitch_oct + v._vib_depth * sin(v._vib_phase)));
+        const double frame = v._frame_center + v._frame_depth * sin(v._frame_phase);
+        v._rspl.set_frame_pos(static_cast<float>(std::max(0.0, std::min(frame, NBR_FRAMES - 1.0))));
+        v._vib_phase += v._vib_inc;
+        v._frame_phase += v._frame_inc;
+    }
+
+    /* returns the real-time factor */
+    double run(std::vector<Voice>& voice_arr, int nbr_voices, double rate, long block, double seconds)
+    {
+        rspl::MixBusFlt bus;
+        bus.set_max_block_len(block);
+        std::vector<float> out(block);
+        const long nbr_blocks = static_cast<long>(ceil(seconds * rate / block));
+
+        rspl::StopWatch sw;
+        sw.start();
+        for (long b = 0; b < nbr_blocks; ++b)
+        {
+            float* bus_ptr = bus.begin_block(block);
+            for (int i = 0; i < nbr_voices; ++i)
+            {
+                Voice& v = voice_arr[i];
+                modulate(v);
+                const float gain = static_cast<float>(v._gain);
+                v._rspl.interpolate_block_add_2x(bus_ptr, block, gain, 0.0f);
+            }
+            bus.end_block(&out[0], block);
+            sink = out[0];
+        }
+        sw.stop();
+
+        const double audio_ns = nbr_blocks * block / rate * 1e9;
+        return sw.get_ns() / audio_ns;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const double budget = (argc > 1) ? atof(argv[1]) : 0.7;
+    const long   block = (argc > 2) ? atol(argv[2]) : 64;
+    const double seconds = (argc > 3) ? atof(argv[3]) : 1.0;
+    if (budget <= 0 || block <= 0 || seconds <= 0)
+    {
+        printf("usage: %s [budget=0.7] [block=64] [seconds=1]\n", argv[0]);
+        return 2;
+    }
+
+    rspl::FrameStore store;
+    rspl::MipMapFlt  mip_map;
+    rspl::InterpPack pack;
+    build_table(store, mip_map);
+
+    printf("# budget=%.2f ns_per_clk=%.6f\n", budget, rspl::StopWatch::get_ns_per_clk());
+    printf("rate,voices,block,rtf,ns_per_voice_spl,max_voices\n");
+
+    const double rate_arr[] = { 44100, 48000, 96000 };
+    for (double rate : rate_arr)
+    {
+        Rnd rnd(0x1234567U);
+        std::vector<Voice> voice_arr(MAX_VOICES);
+        for (Voice& v : voice_arr)
+        {
+            init_voice(v, rnd, store, mip_map, pack, rate, block);
+        }
+
+        for (int nbr_voices = 1; nbr_voices <= MAX_VOICES; nbr_voices *= 2)
+        {
+            /* short warm-up: caches, first crossfades, lazy calibration */
+            run(voice_arr, nbr_voices, rate, block, 0.05);
+            const double rtf = run(voice_arr, nbr_voices, rate, block, seconds);
+            const double ns_per_voice_spl = rtf * 1e9 / (rate * nbr_voices);
+            const long max_voices = static_cast<long>(budget * nbr_voices / rtf);
+            printf("%.0f,%d,%ld,%.5f,%.3f,%ld\n", rate, nbr_voices, block, rtf, ns_per_voice_spl, max_voices);
+            fflush(stdout);
+        }
+    }
+
+    return 0;
+}
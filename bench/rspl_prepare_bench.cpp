@@ -0,0 +1,311 @@
+/******************************************************************************
+    rspl_prepare_bench.cpp - Startup / prepare() cost benchmark
+    No JUCE/HISE dependency. Replays the table build of
+    Griffin_WT::prepare() and times each phase separately:
+
+        generate      procedural cycles into the raw wavetable
+        frame_store   FrameStore::build(): dedup and padding
+        init          MipMapFlt::init_sample(): allocation and zero-fill
+        copy          fill_sample() of all but the last sample
+        levels        the last fill_sample() call, which builds levels 1..n
+
+    Content "griffin" is the node's default (one saw, the rest sines,
+    which dedup to two frames); "distinct" gives every frame its own
+    data, as a loaded wavetable would. Each configuration runs in a
+    child process so peak_rss_kb is its own high-water mark; the
+    one-frame rows give the floor set by the process image. mip_map_kb
+    is what init_sample() allocates.
+
+    Times are the best of REPEATS fresh builds, in milliseconds. A second
+    table splits the level build per level, measured as the difference
+    between maps of n + 1 and n levels; the small levels are within
+    timer noise. Build from the repository root:
+
+        g++ -O2 -I. bench/rspl_prepare_bench.cpp rspl_big_arrays.cpp -o rspl_prepare_bench
+******************************************************************************/
+
+#include "rspl_framestore.h"
+#include "rspl_mipmap.h"
+#include "rspl_resamplerflt.h"
+#include "rspl_stopwatch.h"
+
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined (__unix__) || defined (__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define rspl_PREPARE_BENCH_FORK
+#endif
+
+namespace
+{
+
+    const int REPEATS = 3;
+
+    enum Content { Content_GRIFFIN = 0, Content_DISTINCT };
+
+    class Config
+    {
+    public:
+        Content _content;
+        long    _cycle_len;
+        int     _nbr_frames;
+        int     _nbr_levels;
+    };
+
+    class Result
+    {
+    public:
+        double  _generate_ms;
+        double  _frame_store_ms;
+        double  _init_ms;
+        double  _copy_ms;
+        double  _levels_ms;
+        int     _nbr_unique;
+        long    _table_len;
+        long    _mip_map_bytes;
+    };
+
+    const char* content_name(Content content)
+    {
+        return (content == Content_GRIFFIN) ? "griffin" : "distinct";
+    }
+
+    long get_peak_rss_kb()
+    {
+#if defined (rspl_PREPARE_BENCH_FORK)
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+    #if defined (__APPLE__)
+        return static_cast<long>(usage.ru_maxrss / 1024);   // bytes
+    #else
+        return static_cast<long>(usage.ru_maxrss);          // kB
+    #endif
+#else
+        return -1;
+#endif
+    }
+
+    /* griffin: same as Griffin_WT::generateWavetable(). distinct: a
+       saw-to-sine morph with a per-frame phase shift, so no two frames
+       are equal. */
+    void generate(std::vector<float>& raw, const Config& cfg)
+    {
+        const long len = cfg._cycle_len;
+        raw.resize(cfg._nbr_frames * len);
+        for (int f = 0; f < cfg._nbr_frames; ++f)
+        {
+            float* frame_ptr = &raw[f * len];
+            if (cfg._content == Content_GRIFFIN)
+            {
+                if (f == 0)
+                {
+                    const double saw_step = 2.0 / (static_cast<double>(len) - 1.0);
+                    for (long s = 0; s < len; ++s)
+                    {
+                        frame_ptr[s] = static_cast<float>(0.8 * (-1.0 + saw_step * s));
+                    }
+                }
+                else
+                {
+                    for (long s = 0; s < len; ++s)
+                    {
+                        frame_ptr[s] = static_cast<float>(sin(2 * rspl::PI * s / len));
+                    }
+                }
+            }
+            else
+            {
+                const double mix = static_cast<double>(f) / std::max(1, cfg._nbr_frames - 1);
+                const double shift = 0.01 * f;
+                for (long s = 0; s < len; ++s)
+                {
+                    const double ph = static_cast<double>(s) / len;
+                    const double saw = 2 * ph - 1;
+                    const double sine = sin(2 * rspl::PI * (ph + shift));
+                    frame_ptr[s] = static_cast<float>(0.8 * ((1 - mix) * saw + mix * sine));
+                }
+            }
+        }
+    }
+
+    /* one full build, every phase timed. mip_map must be fresh. */
+    void build_once(Result& res, const Config& cfg, rspl::MipMapFlt& mip_map, int nbr_levels)
+    {
+        rspl::StopWatch sw;
+        std::vector<float> raw;
+        rspl::FrameStore store;
+
+        sw.start();
+        generate(raw, cfg);
+        sw.stop();
+        res._generate_ms = sw.get_ns() * 1e-6;
+
+        sw.start();
+        store.build(&raw[0], cfg._nbr_frames, cfg._cycle_len, cfg._cycle_len / 2);
+        sw.stop();
+        res._frame_store_ms = sw.get_ns() * 1e-6;
+        res._nbr_unique = store.get_nbr_unique_frames();
+        res._table_len = store.get_table_len();
+
+        const long len = store.get_table_len();
+        sw.start();
+        mip_map.init_sample(
+            len,
+            rspl::InterpPack::get_len_pre(),
+            rspl::InterpPack::get_len_post(),
+            nbr_levels,
+            rspl::MIP_MAP_FIR_COEF_ARR,
+            rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
+        sw.stop();
+        res._init_ms = sw.get_ns() * 1e-6;
+
+        sw.start();
+        if (len > 1)
+        {
+            mip_map.fill_sample(store.get_table(), len - 1);
+        }
+        sw.stop();
+        res._copy_ms = sw.get_ns() * 1e-6;
+
+        sw.start();
+        mip_map.fill_sample(store.get_table() + len - 1, 1);
+        sw.stop();
+        res._levels_ms = sw.get_ns() * 1e-6;
+
+        /* what init_sample() allocates: each level plus the filter
+           support on both sides */
+        const long pad = rspl::ResamplerFlt::MIP_MAP_FIR_LEN - 1;
+        res._mip_map_bytes = 0;
+        for (int l = 0; l < nbr_levels; ++l)
+        {
+            const long lev_len = mip_map.get_lev_len(l);
+            res._mip_map_bytes += static_cast<long>(sizeof(float))
+                * (lev_len + std::max(pad, rspl::InterpPack::get_len_pre()) + std::max(pad, rspl::InterpPack::get_len_post()));
+        }
+    }
+
+    /* best of REPEATS, per phase */
+    void build_best(Result& best, const Config& cfg, int nbr_levels)
+    {
+        for (int r = 0; r < REPEATS; ++r)
+        {
+            rspl::MipMapFlt mip_map;
+            Result res;
+            build_once(res, cfg, mip_map, nbr_levels);
+            if (r == 0)
+            {
+                best = res;
+            }
+            else
+            {
+                best._generate_ms = std::min(best._generate_ms, res._generate_ms);
+                best._frame_store_ms = std::min(best._frame_store_ms, res._frame_store_ms);
+                best._init_ms = std::min(best._init_ms, res._init_ms);
+                best._copy_ms = std::min(best._copy_ms, res._copy_ms);
+                best._levels_ms = std::min(best._levels_ms, res._levels_ms);
+            }
+        }
+    }
+
+    void run_config(const Config& cfg)
+    {
+        Result res;
+        build_best(res, cfg, cfg._nbr_levels);
+        const double total_ms = res._generate_ms + res._frame_store_ms + res._init_ms + res._copy_ms + res._levels_ms;
+        printf("%s,%ld,%d,%d,%d,%ld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%ld,%ld\n",
+            content_name(cfg._content), cfg._cycle_len, cfg._nbr_frames, cfg._nbr_levels,
+            res._nbr_unique, res._table_len,
+            res._generate_ms, res._frame_store_ms, res._init_ms, res._copy_ms, res._levels_ms, total_ms,
+            res._mip_map_bytes / 1024, get_peak_rss_kb());
+        fflush(stdout);
+    }
+
+    void run_levels(const Config& cfg)
+    {
+        double prev_ms = 0;
+        for (int n = 1; n <= cfg._nbr_levels; ++n)
+        {
+            Result res;
+            build_best(res, cfg, n);
+            if (n > 1)
+            {
+                printf("%s,%ld,%d,%d,%.4f\n", content_name(cfg._content), cfg._cycle_len, cfg._nbr_frames,
+                    n - 1, std::max(0.0, res._levels_ms - prev_ms));
+            }
+            prev_ms = res._levels_ms;
+        }
+        fflush(stdout);
+    }
+
+    /* isolates the peak RSS of each configuration where fork() exists */
+    template <class F>
+    void run_isolated(F fnc)
+    {
+#if defined (rspl_PREPARE_BENCH_FORK)
+        fflush(stdout);
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+            fnc();
+            _exit(0);
+        }
+        else if (pid > 0)
+        {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            return;
+        }
+#endif
+        fnc();
+    }
+
+} // namespace
+
+int main()
+{
+    /* calibrate once in the parent, the children inherit it */
+    const double ns_per_clk = rspl::StopWatch::get_ns_per_clk();
+    printf("# ns_per_clk=%.6f repeats=%d\n", ns_per_clk, REPEATS);
+    printf("content,cycle_len,frames,levels,unique,table_len,"
+           "generate_ms,frame_store_ms,init_ms,copy_ms,levels_ms,total_ms,mip_map_kb,peak_rss_kb\n");
+
+    const Content content_arr[] = { Content_GRIFFIN, Content_DISTINCT };
+    const long    cycle_len_arr[] = { 1024, 2048, 4096 };
+    const int     nbr_frames_arr[] = { 1, 16, 64, 256 };
+    const int     nbr_levels_arr[] = { 8, 12 };
+
+    for (Content content : content_arr)
+    {
+        for (long cycle_len : cycle_len_arr)
+        {
+            for (int nbr_frames : nbr_frames_arr)
+            {
+                for (int nbr_levels : nbr_levels_arr)
+                {
+                    const Config cfg = { content, cycle_len, nbr_frames, nbr_levels };
+                    run_isolated([&]() { run_config(cfg); });
+                }
+            }
+        }
+    }
+
+    /* per level, on the node's layout and on a full distinct table */
+    printf("\ncontent,cycle_len,frames,level,level_ms\n");
+    const Config level_cfg_arr[] =
+    {
+        { Content_GRIFFIN,  2048, 256, 12 },
+        { Content_DISTINCT, 2048, 256, 12 }
+    };
+    for (const Config& cfg : level_cfg_arr)
+    {
+        run_levels(cfg);
+    }
+
+    return 0;
+}
@@ -23,6 +23,7 @@ namespace rspl
         BaseVoiceState& operator=(const BaseVoiceState& other);
 
         void compute_step(long pitch);
+        bool is_morphing() const;
 
         /* public data ----------------------------------------------------- */
         Fixed3232     _pos;          // 32.32 position
@@ -36,6 +37,11 @@ namespace rspl
         UInt32        _cycle_len;    // power?of?two cycle length
         UInt32        _cycle_mask;   // _cycle_len?1, for wrapping
 
+        /* wavetable morphing */
+        const float* _table_nxt_ptr; // next frame cycle start, 0 if none
+        float         _morph;        // blend towards _table_nxt_ptr, 0..1
+        float         _morph_step;   // _morph increment per interpolated sample
+
     private:
         BaseVoiceState(const BaseVoiceState& other);            // forbidden
         bool operator==(const BaseVoiceState& other);           // forbidden
@@ -46,7 +52,8 @@ namespace rspl
 
     inline BaseVoiceState::BaseVoiceState()
         : _pos(), _step(), _table_ptr(0), _table_len(0), _table(0), _ovrspl_flag(true),
-        _cycle_len(0), _cycle_mask(0)
+        _cycle_len(0), _cycle_mask(0),
+        _table_nxt_ptr(0), _morph(0), _morph_step(0)
     {
         _pos._all = 0;
         _step._all = static_cast<Int64>(0x80000000UL);
@@ -63,9 +70,17 @@ namespace rspl
         _ovrspl_flag = other._ovrspl_flag;
         _cycle_len = other._cycle_len;
         _cycle_mask = other._cycle_mask;
+        _table_nxt_ptr = other._table_nxt_ptr;
+        _morph = other._morph;
+        _morph_step = other._morph_step;
         return *this;
     }
 
+    inline bool BaseVoiceState::is_morphing() const
+    {
+        return (_table_nxt_ptr != 0 && (_morph != 0 || _morph_step != 0));
+    }
+
     inline void BaseVoiceState::compute_step(long pitch)
     {
         int shift;
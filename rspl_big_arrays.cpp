@@ -1,4 +1,7 @@
-#pragma once
+#ifndef RSPL_BIG_ARRAYS_CPP
+#define RSPL_BIG_ARRAYS_CPP
+
+#include "rspl_big_arrays.h"    // gives the definitions external linkage
 #include <cstddef>  // for size_t
 
 namespace rspl {
@@ -622,3 +625,5 @@ namespace rspl {
     const int MIP_MAP_FIR_COEF_ARR_SIZE = sizeof(MIP_MAP_FIR_COEF_ARR) / sizeof(MIP_MAP_FIR_COEF_ARR[0]);
 
 } // namespace rspl
+
+#endif // RSPL_BIG_ARRAYS_CPP
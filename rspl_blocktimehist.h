@@ -0,0 +1,242 @@
+/******************************************************************************
+    rspl_blocktimehist.h - Header-only BlockTimeHist
+    Histogram of per-block render times, for spotting the spikes that an
+    average CPU figure hides. The audio thread is the only writer: it
+    times a block with a BlockTimeHist::Scope and updates the bins with
+    plain relaxed stores, no read-modify-write and no lock. Any other
+    thread may read() a snapshot or request_reset() at any time; the
+    reset is carried out by the writer at the start of its next block.
+
+    Bins are a quarter of an octave wide, from 256 ns up to about 130 ms.
+    The worst block is kept with its length, its index since the last
+    reset and the monotonic time it ended at, published through a
+    sequence counter so the reader never sees a torn record.
+
+    Call StopWatch::get_ns_per_clk() once outside the audio thread
+    (e.g. in prepare()) before the first block: it calibrates lazily.
+******************************************************************************/
+
+#ifndef RSPL_BLOCKTIMEHIST_H
+#define RSPL_BLOCKTIMEHIST_H
+
+#include "rspl.h"
+#include "rspl_stopwatch.h"
+#include <atomic>
+#include <cassert>
+
+namespace rspl {
+
+    class BlockTimeHist
+    {
+    public:
+        enum { NBR_BINS = 4 * 19 + 1 };   // bin 0 is < 256 ns, the last one is open
+
+        class Snapshot
+        {
+        public:
+            long long   _bin_arr [NBR_BINS];
+            long long   _nbr_blocks;
+            double      _total_ns;
+            double      _worst_ns;
+            long long   _worst_index;       // block number since the reset
+            long        _worst_len;         // samples
+            Int64       _worst_stamp_ns;    // StopWatch::read_monotonic_ns()
+        };
+
+        class Scope
+        {
+        public:
+            Scope(BlockTimeHist& hist, long nbr_spl) : _hist(hist), _sw(), _nbr_spl(nbr_spl) { _sw.start(); }
+            ~Scope() { _sw.stop(); _hist.add(_sw.get_ns(), _nbr_spl); }
+        private:
+            BlockTimeHist&  _hist;
+            StopWatch       _sw;
+            long            _nbr_spl;
+            Scope(const Scope&);
+            Scope& operator=(const Scope&);
+        };
+
+        BlockTimeHist();
+        ~BlockTimeHist() {}
+
+        /* audio thread */
+        void add(double ns, long nbr_spl);
+
+        /* any thread */
+        void read(Snapshot& snap) const;
+        void request_reset();
+
+        /* bin ranges and histogram percentile, in ns */
+        static int get_bin(double ns);
+        static double get_bin_lower_ns(int bin);
+        static double get_percentile_ns(const Snapshot& snap, double pct);
+
+    private:
+        void clear();
+
+        std::atomic<long long>  _bin_arr [NBR_BINS];
+        std::atomic<long long>  _nbr_blocks;
+        std::atomic<double>     _total_ns;
+        std::atomic<unsigned>   _worst_seq;     // odd while the writer updates
+        std::atomic<double>     _worst_ns;
+        std::atomic<long long>  _worst_index;
+        std::atomic<long>       _worst_len;
+        std::atomic<Int64>      _worst_stamp_ns;
+        std::atomic<bool>       _reset_flag;
+
+        /* no copies */
+        BlockTimeHist(const BlockTimeHist&);
+        BlockTimeHist& operator=(const BlockTimeHist&);
+    };
+
+    /*----------------------------- constructor -----------------------------*/
+    inline BlockTimeHist::BlockTimeHist()
+        : _nbr_blocks(0), _total_ns(0), _worst_seq(0), _worst_ns(0), _worst_index(0),
+        _worst_len(0), _worst_stamp_ns(0), _reset_flag(false)
+    {
+        for (int b = 0; b < NBR_BINS; ++b)
+        {
+            _bin_arr[b].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /*------------------------------- writer --------------------------------*/
+    inline void BlockTimeHist::add(double ns, long nbr_spl)
+    {
+        if (_reset_flag.load(std::memory_order_acquire))
+        {
+            clear();
+            _reset_flag.store(false, std::memory_order_release);
+        }
+
+        std::atomic<long long>& bin = _bin_arr[get_bin(ns)];
+        bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        const long long index = _nbr_blocks.load(std::memory_order_relaxed);
+        _nbr_blocks.store(index + 1, std::memory_order_relaxed);
+        _total_ns.store(_total_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+
+        if (ns > _worst_ns.load(std::memory_order_relaxed))
+        {
+            const unsigned seq = _worst_seq.load(std::memory_order_relaxed);
+            _worst_seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            _worst_ns.store(ns, std::memory_order_relaxed);
+            _worst_index.store(index, std::memory_order_relaxed);
+            _worst_len.store(nbr_spl, std::memory_order_relaxed);
+            _worst_stamp_ns.store(StopWatch::read_monotonic_ns(), std::memory_order_relaxed);
+            _worst_seq.store(seq + 2, std::memory_order_release);
+        }
+    }
+
+    inline void BlockTimeHist::clear()
+    {
+        for (int b = 0; b < NBR_BINS; ++b)
+        {
+            _bin_arr[b].store(0, std::memory_order_relaxed);
+        }
+        _nbr_blocks.store(0, std::memory_order_relaxed);
+        _total_ns.store(0, std::memory_order_relaxed);
+
+        const unsigned seq = _worst_seq.load(std::memory_order_relaxed);
+        _worst_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _worst_ns.store(0, std::memory_order_relaxed);
+        _worst_index.store(0, std::memory_order_relaxed);
+        _worst_len.store(0, std::memory_order_relaxed);
+        _worst_stamp_ns.store(0, std::memory_order_relaxed);
+        _worst_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    /*------------------------------- reader --------------------------------*/
+    /* The bins and the counters are read one by one and may be a block
+       apart; the worst-block record is always consistent. */
+    inline void BlockTimeHist::read(Snapshot& snap) const
+    {
+        for (int b = 0; b < NBR_BINS; ++b)
+        {
+            snap._bin_arr[b] = _bin_arr[b].load(std::memory_order_relaxed);
+        }
+        snap._nbr_blocks = _nbr_blocks.load(std::memory_order_relaxed);
+        snap._total_ns = _total_ns.load(std::memory_order_relaxed);
+
+        unsigned seq_beg;
+        unsigned seq_end;
+        do
+        {
+            seq_beg = _worst_seq.load(std::memory_order_acquire);
+            snap._worst_ns = _worst_ns.load(std::memory_order_relaxed);
+            snap._worst_index = _worst_index.load(std::memory_order_relaxed);
+            snap._worst_len = _worst_len.load(std::memory_order_relaxed);
+            snap._worst_stamp_ns = _worst_stamp_ns.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seq_end = _worst_seq.load(std::memory_order_relaxed);
+        }
+        while ((seq_beg & 1U) != 0 || seq_beg != seq_end);
+    }
+
+    inline void BlockTimeHist::request_reset()
+    {
+        _reset_flag.store(true, std::memory_order_release);
+    }
+
+    /*------------------------------- bins ----------------------------------*/
+    /* msb and the next two bits of the duration in ns */
+    inline int BlockTimeHist::get_bin(double ns)
+    {
+        if (ns < 256)
+        {
+            return 0;
+        }
+        const double max_ns = 4e18;
+        const unsigned long long val = static_cast<unsigned long long>((ns < max_ns) ? ns : max_ns);
+        int msb = 8;
+        while ((val >> (msb + 1)) != 0)
+        {
+            ++msb;
+        }
+        const int sub = static_cast<int>((val >> (msb - 2)) & 3U);
+        const int bin = 1 + (msb - 8) * 4 + sub;
+        return (bin < NBR_BINS) ? bin : NBR_BINS - 1;
+    }
+
+    inline double BlockTimeHist::get_bin_lower_ns(int bin)
+    {
+        assert(bin >= 0 && bin < NBR_BINS);
+        if (bin == 0)
+        {
+            return 0;
+        }
+        const int msb = 8 + (bin - 1) / 4;
+        const int sub = (bin - 1) % 4;
+        return static_cast<double>(1ULL << msb) * (1.0 + sub * 0.25);
+    }
+
+    /* upper edge of the bin holding the given percentile, so the figure
+       never understates the spikes */
+    inline double BlockTimeHist::get_percentile_ns(const Snapshot& snap, double pct)
+    {
+        assert(pct >= 0 && pct <= 100);
+        long long total = 0;
+        for (int b = 0; b < NBR_BINS; ++b)
+        {
+            total += snap._bin_arr[b];
+        }
+        if (total == 0)
+        {
+            return 0;
+        }
+        const long long rank = static_cast<long long>(pct * 0.01 * total + 0.5);
+        long long acc = 0;
+        for (int b = 0; b < NBR_BINS - 1; ++b)
+        {
+            acc += snap._bin_arr[b];
+            if (acc >= rank)
+            {
+                return get_bin_lower_ns(b + 1);
+            }
+        }
+        return snap._worst_ns;
+    }
+
+} // namespace rspl
+#endif // RSPL_BLOCKTIMEHIST_H
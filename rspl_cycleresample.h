@@ -0,0 +1,68 @@
+/******************************************************************************
+    rspl_cycleresample.h - Header-only resample_cycle()
+    Brings one single-cycle frame of any length to the engine's cycle
+    length, treating it as periodic. Periodic cubic Hermite; a cycle that
+    shrinks by 2 or more is box filtered over the ratio first, which is
+    enough for single-cycle content (the mip map does the real
+    band-limiting afterwards).
+
+    Load-time helper, allocates: not real-time safe. Shared by Griffin_WT
+    and the offline render tool so both build the same table from a file.
+******************************************************************************/
+
+#ifndef RSPL_CYCLERESAMPLE_H
+#define RSPL_CYCLERESAMPLE_H
+
+#include <vector>
+#include <cstring>
+#include <cassert>
+
+namespace rspl {
+
+    inline void resample_cycle(const float src_ptr[], long src_len, float dest_ptr[], long dest_len)
+    {
+        assert(src_ptr != 0 && src_len > 0);
+        assert(dest_ptr != 0 && dest_len > 0);
+
+        if (src_len == dest_len)
+        {
+            memcpy(dest_ptr, src_ptr, sizeof(*dest_ptr) * dest_len);
+            return;
+        }
+
+        std::vector<float> tmp(src_ptr, src_ptr + src_len);
+        const long box = src_len / dest_len;
+        if (box >= 2)
+        {
+            for (long i = 0; i < src_len; ++i)
+            {
+                float sum = 0;
+                for (long k = 0; k < box; ++k)
+                {
+                    sum += src_ptr[(i + k - box / 2 + src_len) % src_len];
+                }
+                tmp[i] = sum / static_cast<float>(box);
+            }
+        }
+
+        const double ratio = static_cast<double>(src_len) / static_cast<double>(dest_len);
+        for (long i = 0; i < dest_len; ++i)
+        {
+            const double pos = i * ratio;
+            const long   p = static_cast<long>(pos);
+            const float  t = static_cast<float>(pos - p);
+            const float  xm1 = tmp[(p - 1 + src_len) % src_len];
+            const float  x0 = tmp[p % src_len];
+            const float  x1 = tmp[(p + 1) % src_len];
+            const float  x2 = tmp[(p + 2) % src_len];
+            const float  c = (x1 - xm1) * 0.5f;
+            const float  v = x0 - x1;
+            const float  w = c + v;
+            const float  a = w + v + (x2 - x0) * 0.5f;
+            const float  b = w + a;
+            dest_ptr[i] = ((a * t - b) * t + c) * t + x0;
+        }
+    }
+
+} // namespace rspl
+#endif // RSPL_CYCLERESAMPLE_H
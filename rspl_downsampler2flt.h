@@ -13,9 +13,15 @@
 #ifndef RSPL_DOWNSAMPLER2FLT_H
 #define RSPL_DOWNSAMPLER2FLT_H
 
+#include "rspl.h"
 
 #include <cassert>
 
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define rspl_DWNSPL_SSE
+    #include <xmmintrin.h>
+#endif
+
 namespace rspl
 {
 
@@ -39,6 +45,21 @@ public:
     // Adjust the phase of a signal by inserting zeros between samples.
     void phase_block(float dest_ptr[], const float src_ptr[], long nbr_spl);
 
+    // Downsample into two outputs with their own linear gain ramps. This
+    // is the output stage of the mix bus: gain and pan are applied as the
+    // samples are written, with no separate pass.
+    void downsample_block_stereo(float dest_l_ptr[], float dest_r_ptr[], const float src_ptr[], long nbr_spl, float vol_l, float vol_l_step, float vol_r, float vol_r_step);
+
+    // Single output sample from a pair of input samples, for frame-based
+    // callers. Same state as downsample_block(), without its call overhead.
+    // Call flush_denormals() every few dozen samples.
+    rspl_FORCEINLINE float downsample_sample(const float src_ptr[2]);
+
+    // Flushes denormals out of the filter state. A path fed only zeros
+    // (zero-stuffed normal-path voices, a silent bus) decays into them.
+    // The block functions call it once per block.
+    void flush_denormals();
+
 private:
     // Magic constant to verify that the coefficients have been set.
     enum { CHK_COEFS_NOT_SET = 12345 };
@@ -107,6 +128,33 @@ inline void Downsampler2Flt::downsample_block(float dest_ptr[], const float src_
         ++pos;
     }
     while (pos < nbr_spl);
+
+    flush_denormals();
+}
+
+inline void Downsampler2Flt::downsample_block_stereo(float dest_l_ptr[], float dest_r_ptr[], const float src_ptr[], long nbr_spl, float vol_l, float vol_l_step, float vol_r, float vol_r_step)
+{
+    assert(_coef_arr[0] != static_cast<float>(CHK_COEFS_NOT_SET));
+    assert(dest_l_ptr != 0);
+    assert(dest_r_ptr != 0);
+    assert(src_ptr != 0);
+    assert(nbr_spl > 0);
+
+    long pos = 0;
+    do
+    {
+        const float path_0 = src_ptr[pos * 2 + 1];
+        const float path_1 = src_ptr[pos * 2    ];
+        const float y = process_sample(path_0, path_1);
+        dest_l_ptr[pos] = y * vol_l;
+        dest_r_ptr[pos] = y * vol_r;
+        vol_l += vol_l_step;
+        vol_r += vol_r_step;
+        ++pos;
+    }
+    while (pos < nbr_spl);
+
+    flush_denormals();
 }
 
 inline void Downsampler2Flt::phase_block(float dest_ptr[], const float src_ptr[], long nbr_spl)
@@ -125,16 +173,23 @@ inline void Downsampler2Flt::phase_block(float dest_ptr[], const float src_ptr[]
     }
     while (pos < nbr_spl);
 
-    // Adjust for potential denormals on path 0:
-    _y_arr[0] += ANTI_DENORMAL_FLT;
-    _y_arr[2] += ANTI_DENORMAL_FLT;
-    _y_arr[4] += ANTI_DENORMAL_FLT;
-    _y_arr[6] += ANTI_DENORMAL_FLT;
+    flush_denormals();
+}
+
+inline void Downsampler2Flt::flush_denormals()
+{
+    for (int mem = 0; mem < NBR_COEFS; ++mem)
+    {
+        _y_arr[mem] += ANTI_DENORMAL_FLT;
+        _y_arr[mem] -= ANTI_DENORMAL_FLT;
+    }
+}
 
-    _y_arr[0] -= ANTI_DENORMAL_FLT;
-    _y_arr[2] -= ANTI_DENORMAL_FLT;
-    _y_arr[4] -= ANTI_DENORMAL_FLT;
-    _y_arr[6] -= ANTI_DENORMAL_FLT;
+rspl_FORCEINLINE float Downsampler2Flt::downsample_sample(const float src_ptr[2])
+{
+    assert(_coef_arr[0] != static_cast<float>(CHK_COEFS_NOT_SET));
+    assert(src_ptr != 0);
+    return process_sample(src_ptr[1], src_ptr[0]);
 }
 
 rspl_FORCEINLINE float Downsampler2Flt::process_sample(float path_0, float path_1)
@@ -171,6 +226,380 @@ rspl_FORCEINLINE float Downsampler2Flt::process_sample(float path_0, float path_
     return (path_0 + path_1);
 }
 
+//---------------------------------------------------------------------------
+// Downsampler2FltN: N independent streams (voices, channels) in SIMD lanes.
+// The filter is a serial chain within one stream, but every lane runs the
+// same chain, so the state is stored lane-minor and each stage is one
+// vector operation over N lanes. Buffers are interleaved: sample pos of
+// lane l is at [pos * N + l]. Use multiples of 4 lanes; they take the
+// explicit SSE path on x86.
+//---------------------------------------------------------------------------
+
+template <int N>
+class Downsampler2FltN
+{
+public:
+    enum { NBR_COEFS = Downsampler2Flt::NBR_COEFS };
+    enum { NBR_LANES = N };
+
+    Downsampler2FltN();
+    ~Downsampler2FltN() {}
+
+    void set_coefs(const double coef_ptr[NBR_COEFS]);
+    void clear_buffers();
+    void clear_lane(int lane);
+
+    // Input holds 2*nbr_spl interleaved frames, output nbr_spl frames.
+    void downsample_block(float dest_ptr[], const float src_ptr[], long nbr_spl);
+
+    // Same as Downsampler2Flt::phase_block(), nbr_spl interleaved frames.
+    void phase_block(float dest_ptr[], const float src_ptr[], long nbr_spl);
+
+    // Same as Downsampler2Flt::flush_denormals(), on every lane.
+    void flush_denormals();
+
+private:
+    enum { CHK_COEFS_NOT_SET = 12345 };
+
+    struct State
+    {
+        alignas(32) float _x_arr[2][N];
+        alignas(32) float _y_arr[NBR_COEFS][N];
+        float _coef_arr[NBR_COEFS];
+    };
+
+    rspl_FORCEINLINE void load_state(State &st) const;
+    rspl_FORCEINLINE void save_state(const State &st);
+    static rspl_FORCEINLINE void process_frame(State &st, float dest_ptr[], const float path_0_ptr[], const float path_1_ptr[]);
+
+#if defined (rspl_DWNSPL_SSE)
+    template <bool PHASE_FLAG>
+    void process_block_sse(float dest_ptr[], const float src_ptr[], long nbr_spl);
+#endif
+
+    float _coef_arr[NBR_COEFS];
+    alignas(32) float _x_arr[2][N];
+    alignas(32) float _y_arr[NBR_COEFS][N];
+
+private:
+    // Forbidden member functions
+    Downsampler2FltN(const Downsampler2FltN &other);
+    Downsampler2FltN &operator=(const Downsampler2FltN &other);
+    bool operator==(const Downsampler2FltN &other);
+    bool operator!=(const Downsampler2FltN &other);
+};
+
+template <int N>
+Downsampler2FltN<N>::Downsampler2FltN()
+: _coef_arr(), _x_arr(), _y_arr()
+{
+    _coef_arr[0] = static_cast<float>(CHK_COEFS_NOT_SET);
+    clear_buffers();
+}
+
+template <int N>
+void Downsampler2FltN<N>::set_coefs(const double coef_ptr[NBR_COEFS])
+{
+    assert(coef_ptr != 0);
+    for (int mem = 0; mem < NBR_COEFS; ++mem)
+    {
+        float coef = static_cast<float>(coef_ptr[mem]);
+        assert(coef > 0);
+        assert(coef < 1);
+        _coef_arr[mem] = coef;
+    }
+}
+
+template <int N>
+void Downsampler2FltN<N>::clear_buffers()
+{
+    for (int lane = 0; lane < N; ++lane)
+    {
+        clear_lane(lane);
+    }
+}
+
+template <int N>
+void Downsampler2FltN<N>::clear_lane(int lane)
+{
+    assert(lane >= 0);
+    assert(lane < N);
+    _x_arr[0][lane] = 0;
+    _x_arr[1][lane] = 0;
+    for (int mem = 0; mem < NBR_COEFS; ++mem)
+    {
+        _y_arr[mem][lane] = 0;
+    }
+}
+
+template <int N>
+void Downsampler2FltN<N>::downsample_block(float dest_ptr[], const float src_ptr[], long nbr_spl)
+{
+    assert(_coef_arr[0] != static_cast<float>(CHK_COEFS_NOT_SET));
+    assert(dest_ptr != 0);
+    assert(src_ptr != 0);
+    assert(nbr_spl > 0);
+
+#if defined (rspl_DWNSPL_SSE)
+    if ((N & 3) == 0)
+    {
+        process_block_sse<false>(dest_ptr, src_ptr, nbr_spl);
+    }
+    else
+#endif
+    {
+        State st;
+        load_state(st);
+
+        long pos = 0;
+        do
+        {
+            const float * path_0_ptr = src_ptr + (pos * 2 + 1) * N;
+            const float * path_1_ptr = src_ptr + (pos * 2    ) * N;
+            process_frame(st, dest_ptr + pos * N, path_0_ptr, path_1_ptr);
+            ++pos;
+        }
+        while (pos < nbr_spl);
+
+        save_state(st);
+    }
+
+    flush_denormals();
+}
+
+template <int N>
+void Downsampler2FltN<N>::phase_block(float dest_ptr[], const float src_ptr[], long nbr_spl)
+{
+    assert(_coef_arr[0] != static_cast<float>(CHK_COEFS_NOT_SET));
+    assert(dest_ptr != 0);
+    assert(src_ptr != 0);
+    assert(nbr_spl > 0);
+
+#if defined (rspl_DWNSPL_SSE)
+    if ((N & 3) == 0)
+    {
+        process_block_sse<true>(dest_ptr, src_ptr, nbr_spl);
+    }
+    else
+#endif
+    {
+        alignas(32) float zero_arr[N] = { 0 };
+
+        State st;
+        load_state(st);
+
+        long pos = 0;
+        do
+        {
+            process_frame(st, dest_ptr + pos * N, zero_arr, src_ptr + pos * N);
+            ++pos;
+        }
+        while (pos < nbr_spl);
+
+        save_state(st);
+    }
+
+    flush_denormals();
+}
+
+template <int N>
+void Downsampler2FltN<N>::flush_denormals()
+{
+    for (int mem = 0; mem < NBR_COEFS; ++mem)
+    {
+        for (int lane = 0; lane < N; ++lane)
+        {
+            _y_arr[mem][lane] += ANTI_DENORMAL_FLT;
+            _y_arr[mem][lane] -= ANTI_DENORMAL_FLT;
+        }
+    }
+}
+
+// The state is copied to a local for the duration of a block: the compiler
+// can then prove it does not alias the buffers and vectorize the lanes.
+template <int N>
+rspl_FORCEINLINE void Downsampler2FltN<N>::load_state(State &st) const
+{
+    for (int mem = 0; mem < NBR_COEFS; ++mem)
+    {
+        st._coef_arr[mem] = _coef_arr[mem];
+        for (int lane = 0; lane < N; ++lane)
+        {
+            st._y_arr[mem][lane] = _y_arr[mem][lane];
+        }
+    }
+    for (int lane = 0; lane < N; ++lane)
+    {
+        st._x_arr[0][lane] = _x_arr[0][lane];
+        st._x_arr[1][lane] = _x_arr[1][lane];
+    }
+}
+
+template <int N>
+rspl_FORCEINLINE void Downsampler2FltN<N>::save_state(const State &st)
+{
+    for (int mem = 0; mem < NBR_COEFS; ++mem)
+    {
+        for (int lane = 0; lane < N; ++lane)
+        {
+            _y_arr[mem][lane] = st._y_arr[mem][lane];
+        }
+    }
+    for (int lane = 0; lane < N; ++lane)
+    {
+        _x_arr[0][lane] = st._x_arr[0][lane];
+        _x_arr[1][lane] = st._x_arr[1][lane];
+    }
+}
+
+// Lane-wise copy of Downsampler2Flt::process_sample(). Inputs are read
+// before any output is written, so dest_ptr may alias path_1_ptr.
+template <int N>
+rspl_FORCEINLINE void Downsampler2FltN<N>::process_frame(State &st, float dest_ptr[], const float path_0_ptr[], const float path_1_ptr[])
+{
+    assert(NBR_COEFS == 7);
+
+    alignas(32) float in_0[N];
+    alignas(32) float in_1[N];
+    alignas(32) float out[N];
+    for (int lane = 0; lane < N; ++lane)
+    {
+        in_0[lane] = path_0_ptr[lane];
+        in_1[lane] = path_1_ptr[lane];
+    }
+
+    for (int lane = 0; lane < N; ++lane)
+    {
+        float path_0 = in_0[lane];
+        float path_1 = in_1[lane];
+
+        float tmp_0 = st._x_arr[0][lane];
+        float tmp_1 = st._x_arr[1][lane];
+        st._x_arr[0][lane] = path_0;
+        st._x_arr[1][lane] = path_1;
+
+        path_0 = (path_0 - st._y_arr[0][lane]) * st._coef_arr[0] + tmp_0;
+        path_1 = (path_1 - st._y_arr[1][lane]) * st._coef_arr[1] + tmp_1;
+        tmp_0 = st._y_arr[0][lane];
+        tmp_1 = st._y_arr[1][lane];
+        st._y_arr[0][lane] = path_0;
+        st._y_arr[1][lane] = path_1;
+
+        path_0 = (path_0 - st._y_arr[2][lane]) * st._coef_arr[2] + tmp_0;
+        path_1 = (path_1 - st._y_arr[3][lane]) * st._coef_arr[3] + tmp_1;
+        tmp_0 = st._y_arr[2][lane];
+        tmp_1 = st._y_arr[3][lane];
+        st._y_arr[2][lane] = path_0;
+        st._y_arr[3][lane] = path_1;
+
+        path_0 = (path_0 - st._y_arr[4][lane]) * st._coef_arr[4] + tmp_0;
+        path_1 = (path_1 - st._y_arr[5][lane]) * st._coef_arr[5] + tmp_1;
+        tmp_0 = st._y_arr[4][lane];
+        st._y_arr[4][lane] = path_0;
+        st._y_arr[5][lane] = path_1;
+
+        path_0 = (path_0 - st._y_arr[6][lane]) * st._coef_arr[6] + tmp_0;
+        st._y_arr[6][lane] = path_0;
+
+        out[lane] = path_0 + path_1;
+    }
+
+    for (int lane = 0; lane < N; ++lane)
+    {
+        dest_ptr[lane] = out[lane];
+    }
+}
+
+#if defined (rspl_DWNSPL_SSE)
+
+// Explicit SSE path for lane counts that are multiples of 4. Each group of
+// 4 lanes keeps its whole filter state in registers for the block.
+template <int N>
+template <bool PHASE_FLAG>
+void Downsampler2FltN<N>::process_block_sse(float dest_ptr[], const float src_ptr[], long nbr_spl)
+{
+    assert(NBR_COEFS == 7);
+
+    const __m128 c0 = _mm_set1_ps(_coef_arr[0]);
+    const __m128 c1 = _mm_set1_ps(_coef_arr[1]);
+    const __m128 c2 = _mm_set1_ps(_coef_arr[2]);
+    const __m128 c3 = _mm_set1_ps(_coef_arr[3]);
+    const __m128 c4 = _mm_set1_ps(_coef_arr[4]);
+    const __m128 c5 = _mm_set1_ps(_coef_arr[5]);
+    const __m128 c6 = _mm_set1_ps(_coef_arr[6]);
+
+    for (int grp = 0; grp < N; grp += 4)
+    {
+        __m128 x0 = _mm_loadu_ps(&_x_arr[0][grp]);
+        __m128 x1 = _mm_loadu_ps(&_x_arr[1][grp]);
+        __m128 y0 = _mm_loadu_ps(&_y_arr[0][grp]);
+        __m128 y1 = _mm_loadu_ps(&_y_arr[1][grp]);
+        __m128 y2 = _mm_loadu_ps(&_y_arr[2][grp]);
+        __m128 y3 = _mm_loadu_ps(&_y_arr[3][grp]);
+        __m128 y4 = _mm_loadu_ps(&_y_arr[4][grp]);
+        __m128 y5 = _mm_loadu_ps(&_y_arr[5][grp]);
+        __m128 y6 = _mm_loadu_ps(&_y_arr[6][grp]);
+
+        for (long pos = 0; pos < nbr_spl; ++pos)
+        {
+            __m128 path_0;
+            __m128 path_1;
+            if (PHASE_FLAG)
+            {
+                path_0 = _mm_setzero_ps();
+                path_1 = _mm_loadu_ps(src_ptr + pos * N + grp);
+            }
+            else
+            {
+                path_0 = _mm_loadu_ps(src_ptr + (pos * 2 + 1) * N + grp);
+                path_1 = _mm_loadu_ps(src_ptr + (pos * 2    ) * N + grp);
+            }
+
+            __m128 tmp_0 = x0;
+            __m128 tmp_1 = x1;
+            x0 = path_0;
+            x1 = path_1;
+
+            path_0 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(path_0, y0), c0), tmp_0);
+            path_1 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(path_1, y1), c1), tmp_1);
+            tmp_0 = y0;
+            tmp_1 = y1;
+            y0 = path_0;
+            y1 = path_1;
+
+            path_0 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(path_0, y2), c2), tmp_0);
+            path_1 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(path_1, y3), c3), tmp_1);
+            tmp_0 = y2;
+            tmp_1 = y3;
+            y2 = path_0;
+            y3 = path_1;
+
+            path_0 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(path_0, y4), c4), tmp_0);
+            path_1 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(path_1, y5), c5), tmp_1);
+            tmp_0 = y4;
+            y4 = path_0;
+            y5 = path_1;
+
+            path_0 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(path_0, y6), c6), tmp_0);
+            y6 = path_0;
+
+            _mm_storeu_ps(dest_ptr + pos * N + grp, _mm_add_ps(path_0, path_1));
+        }
+
+        _mm_storeu_ps(&_x_arr[0][grp], x0);
+        _mm_storeu_ps(&_x_arr[1][grp], x1);
+        _mm_storeu_ps(&_y_arr[0][grp], y0);
+        _mm_storeu_ps(&_y_arr[1][grp], y1);
+        _mm_storeu_ps(&_y_arr[2][grp], y2);
+        _mm_storeu_ps(&_y_arr[3][grp], y3);
+        _mm_storeu_ps(&_y_arr[4][grp], y4);
+        _mm_storeu_ps(&_y_arr[5][grp], y5);
+        _mm_storeu_ps(&_y_arr[6][grp], y6);
+    }
+}
+
+#endif // rspl_DWNSPL_SSE
+
 } // namespace rspl
 
 #endif // RSPL_DOWNSAMPLER2FLT_H
@@ -0,0 +1,148 @@
+/******************************************************************************
+    rspl_eventqueue.h - Header-only EventQueue
+    Fixed capacity queue of timestamped events for one audio thread, and
+    the block splitting built on it: process_block() renders the block in
+    segments between the event offsets and applies each event at the
+    start of its segment. Events closer than min_sub_block to the current
+    split point are applied at it, so dense automation does not degrade
+    into tiny segments. Events timestamped at or past the block end are
+    never pulled in: they stay queued for the next block.
+
+    No allocation, no lock; the callbacks are plain functors:
+
+        queue.process_block(n, 16,
+            [&](const TimedEvent& e) { apply(e); },
+            [&](int pos, int len) { render(pos, len); });
+******************************************************************************/
+
+#ifndef RSPL_EVENTQUEUE_H
+#define RSPL_EVENTQUEUE_H
+
+#include "rspl.h"
+#include <cassert>
+
+namespace rspl {
+
+    class TimedEvent
+    {
+    public:
+        enum Type
+        {
+            Type_NOTE_ON = 0,
+            Type_NOTE_OFF,
+            Type_PARAM
+        };
+
+        int     _offset;        // samples from the start of the next block
+        Type    _type;
+        int     _index;         // note number or parameter index
+        float   _val;           // velocity or parameter value
+        UInt32  _seq;           // parameter change number, see ParamHandoff
+    };
+
+    template <int CAPACITY>
+    class EventQueue
+    {
+    public:
+        enum { CAP = CAPACITY };
+
+        EventQueue() : _nbr_evt(0) {}
+        ~EventQueue() {}
+
+        /* keeps the queue sorted, and stable for equal offsets. Negative
+           offsets are due at once. Fails when the queue is full; the
+           caller then applies the event itself. */
+        bool push(const TimedEvent& evt);
+
+        template <class FA, class FR>
+        void process_block(int nbr_spl, int min_sub_block, FA apply_fnc, FR render_fnc);
+
+        /* applies everything queued, for per-sample processing where the
+           container delivers events at their sample */
+        template <class FA>
+        void flush(FA apply_fnc);
+
+        void clear() { _nbr_evt = 0; }
+        int get_nbr_events() const { return _nbr_evt; }
+        const TimedEvent& use_event(int pos) const;
+
+    private:
+        TimedEvent  _evt_arr[CAPACITY];
+        int         _nbr_evt;
+
+        /* no copies */
+        EventQueue(const EventQueue&);
+        EventQueue& operator=(const EventQueue&);
+    };
+
+    /*------------------------------- queue ---------------------------------*/
+    template <int CAPACITY>
+    inline bool EventQueue<CAPACITY>::push(const TimedEvent& evt)
+    {
+        if (_nbr_evt == CAPACITY)
+        {
+            return false;
+        }
+        int pos = _nbr_evt++;
+        while (pos > 0 && _evt_arr[pos - 1]._offset > evt._offset)
+        {
+            _evt_arr[pos] = _evt_arr[pos - 1];
+            --pos;
+        }
+        _evt_arr[pos] = evt;
+        _evt_arr[pos]._offset = max(evt._offset, 0);
+        return true;
+    }
+
+    template <int CAPACITY>
+    inline const TimedEvent& EventQueue<CAPACITY>::use_event(int pos) const
+    {
+        assert(pos >= 0 && pos < _nbr_evt);
+        return _evt_arr[pos];
+    }
+
+    /*------------------------------ splitting ------------------------------*/
+    /* render_fnc(pos, len) renders samples pos .. pos + len - 1 of the
+       block, apply_fnc(evt) applies one event */
+    template <int CAPACITY>
+    template <class FA, class FR>
+    inline void EventQueue<CAPACITY>::process_block(int nbr_spl, int min_sub_block, FA apply_fnc, FR render_fnc)
+    {
+        int pos = 0;
+        int next = 0;
+        while (pos < nbr_spl)
+        {
+            const int join_end = min(pos + min_sub_block, nbr_spl);
+            while (next < _nbr_evt && _evt_arr[next]._offset < join_end)
+            {
+                apply_fnc(_evt_arr[next++]);
+            }
+
+            const int end = (next < _nbr_evt) ? min(_evt_arr[next]._offset, nbr_spl) : nbr_spl;
+            render_fnc(pos, end - pos);
+            pos = end;
+        }
+
+        /* keep events timestamped past this block for the next one */
+        int kept = 0;
+        for (int i = next; i < _nbr_evt; ++i)
+        {
+            _evt_arr[kept] = _evt_arr[i];
+            _evt_arr[kept++]._offset -= nbr_spl;
+        }
+        _nbr_evt = kept;
+    }
+
+    template <int CAPACITY>
+    template <class FA>
+    inline void EventQueue<CAPACITY>::flush(FA apply_fnc)
+    {
+        for (int i = 0; i < _nbr_evt; ++i)
+        {
+            apply_fnc(_evt_arr[i]);
+        }
+        _nbr_evt = 0;
+    }
+
+} // namespace rspl
+#endif // RSPL_EVENTQUEUE_H
@@ -0,0 +1,167 @@
+/******************************************************************************
+    rspl_framestore.h - Header-only FrameStore
+    Packs single-cycle frames into the padded layout ResamplerFlt expects
+    (cycle followed by a copy of its start) and stores each distinct frame
+    once. Frames are matched on an exact hash of their samples; with a
+    tolerance > 0 a frame also merges into the previously stored frame when
+    no sample differs by more than the tolerance, which catches runs of
+    near-identical frames. The frame map turns a frame number into the slot
+    that holds its data, so the mip map is built from unique content only.
+******************************************************************************/
+
+#ifndef RSPL_FRAMESTORE_H
+#define RSPL_FRAMESTORE_H
+
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+
+namespace rspl {
+
+    class FrameStore
+    {
+    public:
+        FrameStore();
+        ~FrameStore() {}
+
+        /* allocation, not real-time safe. src_ptr holds nbr_frames cycles
+           of cycle_len samples back to back. */
+        void build(const float src_ptr[], int nbr_frames, long cycle_len, long pad_len, float tolerance = 0);
+
+        const float* get_table() const;
+        long  get_table_len() const;
+        long  get_frame_stride() const;
+        int   get_nbr_frames() const;
+        int   get_nbr_unique_frames() const;
+        const int* get_frame_map() const;
+
+    private:
+        static unsigned long hash_frame(const float frame_ptr[], long len);
+        bool is_same_frame(const float a_ptr[], const float b_ptr[], long len, float tolerance) const;
+
+        std::vector<float> _table;         // unique frames, padded
+        std::vector<int>   _frame_map;     // frame -> slot
+        std::vector<unsigned long> _slot_hash;
+        long               _cycle_len;
+        long               _stride;
+        int                _nbr_unique;
+
+        /* no copies */
+        FrameStore(const FrameStore&);
+        FrameStore& operator=(const FrameStore&);
+    };
+
+    /*----------------------------- constructor -----------------------------*/
+    inline FrameStore::FrameStore()
+        : _table(), _frame_map(), _slot_hash(), _cycle_len(0), _stride(0), _nbr_unique(0)
+    {
+    }
+
+    /*------------------------------- build ---------------------------------*/
+    inline void FrameStore::build(const float src_ptr[], int nbr_frames, long cycle_len, long pad_len, float tolerance)
+    {
+        assert(src_ptr != 0);
+        assert(nbr_frames > 0);
+        assert(cycle_len > 0);
+        assert(pad_len >= 0 && pad_len <= cycle_len);
+        assert(tolerance >= 0);
+
+        _cycle_len = cycle_len;
+        _stride = cycle_len + pad_len;
+        _frame_map.assign(nbr_frames, 0);
+        _slot_hash.clear();
+        _slot_hash.reserve(nbr_frames);
+        _table.resize(nbr_frames * _stride);
+        _nbr_unique = 0;
+
+        for (int f = 0; f < nbr_frames; ++f)
+        {
+            const float* frame_ptr = src_ptr + f * cycle_len;
+            const unsigned long h = hash_frame(frame_ptr, cycle_len);
+
+            /* exact match first, then the tolerance check against the
+               last stored frame */
+            int slot = -1;
+            for (int s = 0; s < _nbr_unique && slot < 0; ++s)
+            {
+                if (_slot_hash[s] == h && is_same_frame(&_table[s * _stride], frame_ptr, cycle_len, 0))
+                {
+                    slot = s;
+                }
+            }
+            if (slot < 0 && tolerance > 0 && _nbr_unique > 0)
+            {
+                const int last = _nbr_unique - 1;
+                if (is_same_frame(&_table[last * _stride], frame_ptr, cycle_len, tolerance))
+                {
+                    slot = last;
+                }
+            }
+
+            if (slot < 0)
+            {
+                slot = _nbr_unique++;
+                float* dest_ptr = &_table[slot * _stride];
+                memcpy(dest_ptr, frame_ptr, sizeof(*dest_ptr) * cycle_len);
+                memcpy(dest_ptr + cycle_len, frame_ptr, sizeof(*dest_ptr) * pad_len);
+                _slot_hash.push_back(h);
+            }
+            _frame_map[f] = slot;
+        }
+
+        _table.resize(_nbr_unique * _stride);
+    }
+
+    /*------------------------------ access ---------------------------------*/
+    inline const float* FrameStore::get_table() const
+    {
+        assert(!_table.empty());
+        return &_table[0];
+    }
+
+    inline long FrameStore::get_table_len() const { return static_cast<long>(_table.size()); }
+    inline long FrameStore::get_frame_stride() const { return _stride; }
+    inline int FrameStore::get_nbr_frames() const { return static_cast<int>(_frame_map.size()); }
+    inline int FrameStore::get_nbr_unique_frames() const { return _nbr_unique; }
+
+    inline const int* FrameStore::get_frame_map() const
+    {
+        assert(!_frame_map.empty());
+        return &_frame_map[0];
+    }
+
+    /*------------------------------ private --------------------------------*/
+    /* FNV-1a over the sample bit patterns */
+    inline unsigned long FrameStore::hash_frame(const float frame_ptr[], long len)
+    {
+        const unsigned char* byte_ptr = reinterpret_cast<const unsigned char*>(frame_ptr);
+        const long nbr_bytes = len * static_cast<long>(sizeof(*frame_ptr));
+        unsigned long h = 2166136261UL;
+        for (long i = 0; i < nbr_bytes; ++i)
+        {
+            h ^= byte_ptr[i];
+            h *= 16777619UL;
+            h &= 0xFFFFFFFFUL;
+        }
+        return h;
+    }
+
+    inline bool FrameStore::is_same_frame(const float a_ptr[], const float b_ptr[], long len, float tolerance) const
+    {
+        if (tolerance <= 0)
+        {
+            return (memcmp(a_ptr, b_ptr, sizeof(*a_ptr) * len) == 0);
+        }
+        for (long i = 0; i < len; ++i)
+        {
+            if (std::fabs(a_ptr[i] - b_ptr[i]) > tolerance)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace rspl
+#endif // RSPL_FRAMESTORE_H
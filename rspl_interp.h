@@ -1,9 +1,17 @@
 #ifndef RSPL_INTERP_H
 #define RSPL_INTERP_H
 
+#include "rspl.h"
+#include "rspl_basevoicestate.h"
+#include "rspl_big_arrays.h"
 #include <cassert>
 #include <cmath>
 
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define rspl_INTERP_SSE
+    #include <xmmintrin.h>
+#endif
+
 namespace rspl {
 
     /*=========================== InterpFltPhase ============================*/
@@ -118,6 +126,24 @@ namespace rspl {
             UInt32    frac_pos,
             UInt32    cycle_mask) const;
 
+        /* two-frame variant: one phase lookup and one coefficient blend,
+           applied to the frame mix a + (b - a) * morph */
+        rspl_FORCEINLINE float interpolate_masked_morph(const float table_ptr[],
+            const float table_nxt_ptr[],
+            UInt32    base_idx,
+            UInt32    frac_pos,
+            UInt32    cycle_mask,
+            float     morph) const;
+
+        /* four lanes reading the same table and cycle at their own
+           positions, one sample each into dest_ptr. Same result as four
+           interpolate_masked() calls, up to the summation order. */
+        rspl_FORCEINLINE void interpolate_masked_x4(float dest_ptr[4],
+            const float table_ptr[],
+            const UInt32 base_idx_arr[4],
+            const UInt32 frac_pos_arr[4],
+            UInt32    cycle_mask) const;
+
     private:
         Phase _phase_arr[NBR_PHASES];
     };
@@ -179,6 +205,90 @@ namespace rspl {
         return sum;
     }
 
+    template <int SC>
+    rspl_FORCEINLINE float InterpFlt<SC>::interpolate_masked_morph(const float table_ptr[],
+        const float table_nxt_ptr[],
+        UInt32 base_idx,
+        UInt32 frac_pos,
+        UInt32 cycle_mask,
+        float morph) const
+    {
+        const float q_scl = 1.0f / (65536.0f * 65536.0f);
+        const float q = static_cast<float>(frac_pos << NBR_PHASES_L2) * q_scl;
+        const int   ph = frac_pos >> (32 - NBR_PHASES_L2);
+        const Phase& phase = _phase_arr[ph];
+        const int offset = -FIR_LEN / 2 + 1;
+
+        float sum = 0.0f;
+        for (int tap = 0; tap < FIR_LEN; ++tap)
+        {
+            const UInt32 idx = (base_idx + offset + tap) & cycle_mask;
+            const float  a = table_ptr[idx];
+            const float  b = table_nxt_ptr[idx];
+            sum += (phase._imp[tap] + phase._dif[tap] * q) * (a + (b - a) * morph);
+        }
+        return sum;
+    }
+
+    /* With SSE, each lane runs its FIR four taps at a time and one 4x4
+       transpose sums the four lanes together. The taps are read in place
+       unless the window wraps around the cycle; then they are gathered
+       through the mask first. */
+    template <int SC>
+    rspl_FORCEINLINE void InterpFlt<SC>::interpolate_masked_x4(float dest_ptr[4],
+        const float table_ptr[],
+        const UInt32 base_idx_arr[4],
+        const UInt32 frac_pos_arr[4],
+        UInt32 cycle_mask) const
+    {
+#if defined (rspl_INTERP_SSE)
+        static_assert((FIR_LEN & 3) == 0, "FIR length must be a multiple of 4");
+        const float q_scl = 1.0f / (65536.0f * 65536.0f);
+        const int   offset = -FIR_LEN / 2 + 1;
+
+        __m128 acc_arr[4];
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            const UInt32 frac_pos = frac_pos_arr[lane];
+            const __m128 q = _mm_set1_ps(static_cast<float>(frac_pos << NBR_PHASES_L2) * q_scl);
+            const Phase& phase = _phase_arr[frac_pos >> (32 - NBR_PHASES_L2)];
+            const UInt32 beg = (base_idx_arr[lane] + offset) & cycle_mask;
+
+            const float* data_ptr = table_ptr + beg;
+            float tmp_arr[FIR_LEN];
+            if (beg + FIR_LEN > cycle_mask + 1)
+            {
+                for (int tap = 0; tap < FIR_LEN; ++tap)
+                {
+                    tmp_arr[tap] = table_ptr[(beg + tap) & cycle_mask];
+                }
+                data_ptr = tmp_arr;
+            }
+
+            __m128 acc = _mm_setzero_ps();
+            for (int tap = 0; tap < FIR_LEN; tap += 4)
+            {
+                const __m128 imp = _mm_loadu_ps(phase._imp + tap);
+                const __m128 dif = _mm_loadu_ps(phase._dif + tap);
+                const __m128 x = _mm_loadu_ps(data_ptr + tap);
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_add_ps(imp, _mm_mul_ps(dif, q)), x));
+            }
+            acc_arr[lane] = acc;
+        }
+
+        _MM_TRANSPOSE4_PS(acc_arr[0], acc_arr[1], acc_arr[2], acc_arr[3]);
+        const __m128 sum = _mm_add_ps(_mm_add_ps(acc_arr[0], acc_arr[1]),
+                                      _mm_add_ps(acc_arr[2], acc_arr[3]));
+        _mm_storeu_ps(dest_ptr, sum);
+#else
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            dest_ptr[lane] = interpolate_masked(table_ptr, base_idx_arr[lane],
+                frac_pos_arr[lane], cycle_mask);
+        }
+#endif
+    }
+
     /*============================= InterpPack ==============================*/
 
     class InterpPack
@@ -193,6 +303,16 @@ namespace rspl {
         void interp_norm_ramp_add(float dest_ptr[], long nbr_spl,
             BaseVoiceState& v, float vol, float vol_step) const;
 
+        /* stereo accumulation of a unison stack into a 2x bus, all voices
+           in one pass. The voices share table, cycle and path. */
+        enum { MAX_STACK = 16 };
+        void interp_ovrspl_stack_add(float dest_l_ptr[], float dest_r_ptr[], long nbr_spl,
+            BaseVoiceState v_arr[], int nbr_voices, float vol, float vol_step,
+            const float pan_l_arr[], const float pan_r_arr[]) const;
+        void interp_norm_stack_add(float dest_l_ptr[], float dest_r_ptr[], long nbr_spl,
+            BaseVoiceState v_arr[], int nbr_voices, float vol, float vol_step,
+            const float pan_l_arr[], const float pan_r_arr[]) const;
+
         static long get_len_pre();
         static long get_len_post();
 
@@ -200,6 +320,14 @@ namespace rspl {
         typedef InterpFlt<2> InterpRate1x;  // oversampled
         typedef InterpFlt<1> InterpRate2x;  // normal
 
+        template <bool ADD_FLAG, class IF>
+        static void interp_morph(const IF& interp, float dest_ptr[], long nbr_spl, long stride,
+            BaseVoiceState& v, float vol, float vol_step);
+        template <class IF>
+        static void interp_stack(const IF& interp, float dest_l_ptr[], float dest_r_ptr[],
+            long nbr_spl, long stride, BaseVoiceState v_arr[], int nbr_voices,
+            float vol, float vol_step, const float pan_l_arr[], const float pan_r_arr[]);
+
         InterpRate1x _interp_1x;
         InterpRate2x _interp_2x;
     };
@@ -213,6 +341,11 @@ namespace rspl {
     /*---------------------- masked core helpers ----------------------------*/
     inline void InterpPack::interp_ovrspl(float dest_ptr[], long n, BaseVoiceState& v) const
     {
+        if (v.is_morphing())
+        {
+            interp_morph<false>(_interp_2x, dest_ptr, n, 1, v, 0.5f, 0.0f);
+            return;
+        }
         const UInt32 mask = v._cycle_mask;
         for (long i = 0; i < n; ++i)
         {
@@ -224,6 +357,11 @@ namespace rspl {
 
     inline void InterpPack::interp_norm(float dest_ptr[], long n, BaseVoiceState& v) const
     {
+        if (v.is_morphing())
+        {
+            interp_morph<false>(_interp_1x, dest_ptr, n, 1, v, 1.0f, 0.0f);
+            return;
+        }
         const UInt32 mask = v._cycle_mask;
         for (long i = 0; i < n; ++i)
         {
@@ -239,6 +377,11 @@ namespace rspl {
     {
         vol *= 0.5f;
         vol_step *= 0.5f;
+        if (v.is_morphing())
+        {
+            interp_morph<true>(_interp_2x, dest_ptr, n, 1, v, vol, vol_step);
+            return;
+        }
         const UInt32 mask = v._cycle_mask;
         for (long i = 0; i < n; ++i)
         {
@@ -254,6 +397,11 @@ namespace rspl {
         float vol, float vol_step) const
     {
         vol_step *= 2.0f;
+        if (v.is_morphing())
+        {
+            interp_morph<true>(_interp_1x, dest_ptr, n, 2, v, vol, vol_step);
+            return;
+        }
         const UInt32 mask = v._cycle_mask;
         long i = 0;
         while (i < n)
@@ -266,6 +414,111 @@ namespace rspl {
         }
     }
 
+    /*-------------------------- morphing core ------------------------------*/
+    /* Shared by all paths once a voice blends two frames. Gains are already
+       scaled by the caller; the morph amount ramps per interpolated sample. */
+    template <bool ADD_FLAG, class IF>
+    inline void InterpPack::interp_morph(const IF& interp, float dest_ptr[], long n, long stride,
+        BaseVoiceState& v, float vol, float vol_step)
+    {
+        const UInt32 mask = v._cycle_mask;
+        for (long i = 0; i < n; i += stride)
+        {
+            const float s = vol * interp.interpolate_masked_morph(
+                v._table_ptr, v._table_nxt_ptr,
+                v._pos._part._msw, v._pos._part._lsw, mask, v._morph);
+            if (ADD_FLAG) { dest_ptr[i] += s; }
+            else          { dest_ptr[i] = s; }
+            v._pos._all += v._step._all;
+            v._morph += v._morph_step;
+            vol += vol_step;
+        }
+    }
+
+    /*------------------------- unison stack core ---------------------------*/
+    /* Same strides and gain conventions as the ramp_add variants. The
+       stack is walked once: per output sample, the voices are lanes of
+       fixed-size position / sample arrays, interpolated four at a time
+       (interpolate_masked_x4(), SSE when available), then panned and
+       summed in registers. The bus is touched once per channel instead of
+       once per voice. A stack that is not a multiple of 4 runs its last
+       lanes one by one. */
+    inline void InterpPack::interp_ovrspl_stack_add(float dest_l_ptr[], float dest_r_ptr[], long n,
+        BaseVoiceState v_arr[], int nbr_voices, float vol, float vol_step,
+        const float pan_l_arr[], const float pan_r_arr[]) const
+    {
+        interp_stack(_interp_2x, dest_l_ptr, dest_r_ptr, n, 1, v_arr, nbr_voices,
+            vol * 0.5f, vol_step * 0.5f, pan_l_arr, pan_r_arr);
+    }
+
+    inline void InterpPack::interp_norm_stack_add(float dest_l_ptr[], float dest_r_ptr[], long n,
+        BaseVoiceState v_arr[], int nbr_voices, float vol, float vol_step,
+        const float pan_l_arr[], const float pan_r_arr[]) const
+    {
+        interp_stack(_interp_1x, dest_l_ptr, dest_r_ptr, n, 2, v_arr, nbr_voices,
+            vol, vol_step * 2.0f, pan_l_arr, pan_r_arr);
+    }
+
+    template <class IF>
+    inline void InterpPack::interp_stack(const IF& interp, float dest_l_ptr[], float dest_r_ptr[],
+        long n, long stride, BaseVoiceState v_arr[], int nbr_voices,
+        float vol, float vol_step, const float pan_l_arr[], const float pan_r_arr[])
+    {
+        assert(nbr_voices > 0 && nbr_voices <= MAX_STACK);
+        const float* table_ptr = v_arr[0]._table_ptr;
+        const UInt32 mask = v_arr[0]._cycle_mask;
+
+        Fixed3232 pos_arr[MAX_STACK];
+        Int64     step_arr[MAX_STACK];
+        float     spl_arr[MAX_STACK];
+        for (int k = 0; k < nbr_voices; ++k)
+        {
+            assert(v_arr[k]._table_ptr == table_ptr);
+            pos_arr[k] = v_arr[k]._pos;
+            step_arr[k] = v_arr[k]._step._all;
+        }
+
+        const int nbr_grp_lanes = nbr_voices & ~3;
+        for (long i = 0; i < n; i += stride)
+        {
+            for (int k = 0; k < nbr_grp_lanes; k += 4)
+            {
+                UInt32 base_arr[4];
+                UInt32 frac_arr[4];
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    base_arr[lane] = pos_arr[k + lane]._part._msw;
+                    frac_arr[lane] = pos_arr[k + lane]._part._lsw;
+                }
+                interp.interpolate_masked_x4(&spl_arr[k], table_ptr, base_arr, frac_arr, mask);
+            }
+            for (int k = nbr_grp_lanes; k < nbr_voices; ++k)
+            {
+                spl_arr[k] = interp.interpolate_masked(
+                    table_ptr, pos_arr[k]._part._msw, pos_arr[k]._part._lsw, mask);
+            }
+            for (int k = 0; k < nbr_voices; ++k)
+            {
+                pos_arr[k]._all += step_arr[k];
+            }
+            float sum_l = 0;
+            float sum_r = 0;
+            for (int k = 0; k < nbr_voices; ++k)
+            {
+                sum_l += spl_arr[k] * pan_l_arr[k];
+                sum_r += spl_arr[k] * pan_r_arr[k];
+            }
+            dest_l_ptr[i] += vol * sum_l;
+            dest_r_ptr[i] += vol * sum_r;
+            vol += vol_step;
+        }
+
+        for (int k = 0; k < nbr_voices; ++k)
+        {
+            v_arr[k]._pos = pos_arr[k];
+        }
+    }
+
     inline long InterpPack::get_len_pre() { return static_cast<long>(InterpRate1x::FIR_LEN / 2); }
     inline long InterpPack::get_len_post() { return static_cast<long>(InterpRate1x::FIR_LEN / 2); }
 
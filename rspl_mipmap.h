@@ -13,6 +13,7 @@
 #ifndef RSPL_MIPMAP_H
 #define RSPL_MIPMAP_H
 
+#include "rspl.h"
 #include <vector>
 #include <cassert>
 
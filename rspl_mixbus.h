@@ -0,0 +1,162 @@
+/******************************************************************************
+    rspl_mixbus.h - Header-only MixBusFlt
+    Shared 2x rate mix bus. Voices accumulate into it with
+    ResamplerFlt::interpolate_block_add_2x() and the bus runs a single
+    Downsampler2Flt, so decimation costs the same for 1 or 256 voices.
+    The downsampler is linear and time-invariant, so summing before it is
+    equivalent to summing the individually decimated voices. Its state is
+    flushed of denormals once per block, or every FLUSH_PERIOD frames, as
+    phase_block() does for a single normal-path voice.
+******************************************************************************/
+
+#ifndef RSPL_MIXBUS_H
+#define RSPL_MIXBUS_H
+
+#include "rspl.h"
+#include "rspl_big_arrays.h"
+#include "rspl_downsampler2flt.h"
+#include "rspl_proc2x.h"
+#include <vector>
+#include <cstring>
+#include <cassert>
+
+namespace rspl {
+
+    class Proc2xInterface;
+
+    class MixBusFlt
+    {
+    public:
+        enum { FLUSH_PERIOD = 64 };     // frames between denormal flushes
+
+        MixBusFlt();
+        ~MixBusFlt() {}
+
+        /* allocation, not real-time safe */
+        void set_max_block_len(long max_len);
+        long get_max_block_len() const;
+        void set_proc_2x(Proc2xInterface* proc_ptr);
+        bool needs_ovrspl() const;
+
+        /* render */
+        float* begin_block(long nbr_spl);
+        void end_block(float dest_ptr[], long nbr_spl);
+        void end_block_stereo(float dest_l_ptr[], float dest_r_ptr[], long nbr_spl, float vol_l, float vol_l_step, float vol_r, float vol_r_step, long ramp_len);
+        float* begin_frame();
+        float end_frame();
+        void clear_buffers();
+
+    private:
+        std::vector<float> _buf;
+        float              _frame_buf[2];
+        Proc2xInterface* _proc_2x_ptr;
+        Downsampler2Flt    _dwnspl;
+        long               _max_len;
+        long               _frame_cnt;
+
+        /* no copies */
+        MixBusFlt(const MixBusFlt&);
+        MixBusFlt& operator=(const MixBusFlt&);
+    };
+
+    /*----------------------------- constructor -----------------------------*/
+    inline MixBusFlt::MixBusFlt()
+        : _buf(), _frame_buf(), _proc_2x_ptr(0), _dwnspl(), _max_len(0), _frame_cnt(0)
+    {
+        _dwnspl.set_coefs(DOWNSAMPLER_COEF_ARR);
+    }
+
+    inline void MixBusFlt::set_max_block_len(long max_len)
+    {
+        assert(max_len > 0);
+        _max_len = max_len;
+        _buf.assign(max_len * 2, 0.0f);
+    }
+
+    inline long MixBusFlt::get_max_block_len() const { return _max_len; }
+
+    /* processes the whole mix at 2x, after the voices and before the
+       decimation. Pass 0 to detach. The voices feeding the bus must then
+       render at 2x whatever their pitch: call
+       ResamplerFlt::set_force_ovrspl(needs_ovrspl()) on each of them. */
+    inline void MixBusFlt::set_proc_2x(Proc2xInterface* proc_ptr)
+    {
+        _proc_2x_ptr = proc_ptr;
+    }
+
+    inline bool MixBusFlt::needs_ovrspl() const { return (_proc_2x_ptr != 0); }
+
+    /*---------------------------- rendering --------------------------------*/
+    /* Returns the cleared 2x bus, nbr_spl * 2 samples long. */
+    inline float* MixBusFlt::begin_block(long nbr_spl)
+    {
+        assert(nbr_spl > 0);
+        assert(nbr_spl <= _max_len);
+        memset(&_buf[0], 0, sizeof(_buf[0]) * nbr_spl * 2);
+        return &_buf[0];
+    }
+
+    inline void MixBusFlt::end_block(float dest_ptr[], long nbr_spl)
+    {
+        assert(dest_ptr != 0);
+        assert(nbr_spl > 0);
+        assert(nbr_spl <= _max_len);
+        if (_proc_2x_ptr) { _proc_2x_ptr->process_block_2x(&_buf[0], nbr_spl * 2); }
+        _dwnspl.downsample_block(dest_ptr, &_buf[0], nbr_spl);
+    }
+
+    /* Decimates straight into the output channels, applying the gains as
+       it writes. The gains ramp for ramp_len samples (<= nbr_spl) and hold
+       their final value for the rest of the block. */
+    inline void MixBusFlt::end_block_stereo(float dest_l_ptr[], float dest_r_ptr[], long nbr_spl, float vol_l, float vol_l_step, float vol_r, float vol_r_step, long ramp_len)
+    {
+        assert(dest_l_ptr != 0);
+        assert(dest_r_ptr != 0);
+        assert(nbr_spl > 0);
+        assert(nbr_spl <= _max_len);
+        assert(ramp_len >= 0 && ramp_len <= nbr_spl);
+        if (_proc_2x_ptr) { _proc_2x_ptr->process_block_2x(&_buf[0], nbr_spl * 2); }
+
+        if (ramp_len > 0)
+        {
+            _dwnspl.downsample_block_stereo(dest_l_ptr, dest_r_ptr, &_buf[0], ramp_len,
+                vol_l, vol_l_step, vol_r, vol_r_step);
+            vol_l += vol_l_step * ramp_len;
+            vol_r += vol_r_step * ramp_len;
+        }
+        if (ramp_len < nbr_spl)
+        {
+            _dwnspl.downsample_block_stereo(dest_l_ptr + ramp_len, dest_r_ptr + ramp_len,
+                &_buf[ramp_len * 2], nbr_spl - ramp_len, vol_l, 0.0f, vol_r, 0.0f);
+        }
+    }
+
+    /* Frame mode: one output sample, two bus samples. Shares the
+       downsampler state with the block mode, so both can be mixed. */
+    inline float* MixBusFlt::begin_frame()
+    {
+        _frame_buf[0] = 0;
+        _frame_buf[1] = 0;
+        return _frame_buf;
+    }
+
+    inline float MixBusFlt::end_frame()
+    {
+        if (_proc_2x_ptr) { _proc_2x_ptr->process_block_2x(_frame_buf, 2); }
+        const float out = _dwnspl.downsample_sample(_frame_buf);
+        if (++_frame_cnt >= FLUSH_PERIOD)
+        {
+            _dwnspl.flush_denormals();
+            _frame_cnt = 0;
+        }
+        return out;
+    }
+
+    inline void MixBusFlt::clear_buffers()
+    {
+        _dwnspl.clear_buffers();
+        if (_proc_2x_ptr) { _proc_2x_ptr->clear_buffers(); }
+    }
+
+} // namespace rspl
+#endif // RSPL_MIXBUS_H
@@ -0,0 +1,176 @@
+/******************************************************************************
+    rspl_paramhandoff.h - Header-only ParamHandoff
+    Lock-free parameter handoff from control threads to the audio thread.
+    set() writes a per-parameter atomic slot, so bursts coalesce to the
+    latest value; set_at() pushes a timestamped change into an SPSC queue
+    (one producer thread), and falls back to the slot when the queue is
+    full.
+
+    Every change takes a number from one counter. A slot packs the value
+    with its number, and a timestamped change carries its own, so the
+    audio thread can apply "newest wins" wherever a change lands: accept()
+    refuses a change older than the last one applied to its parameter.
+    This holds across blocks, for changes that wait in an event queue.
+
+    The audio thread is the only consumer: pop() must never run anywhere
+    else. pull_slots() may also run from prepare(), as long as it cannot
+    overlap a block.
+******************************************************************************/
+
+#ifndef RSPL_PARAMHANDOFF_H
+#define RSPL_PARAMHANDOFF_H
+
+#include "rspl.h"
+#include "rspl_spscqueue.h"
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+namespace rspl {
+
+    template <int NBR_PARAM, int QUEUE_CAP>
+    class ParamHandoff
+    {
+    public:
+        static_assert(NBR_PARAM > 0 && NBR_PARAM <= 32, "one dirty bit per parameter");
+
+        class Change
+        {
+        public:
+            int     _index;
+            float   _val;
+            int     _offset;    // samples into the next block
+            UInt32  _seq;
+        };
+
+        ParamHandoff();
+        ~ParamHandoff() {}
+
+        /* control threads */
+        void set(int index, float val);
+        void set_at(int index, float val, int offset);
+
+        /* audio thread. pull_slots() calls apply_fnc(index, val) for each
+           slot written since the last pull and not overtaken. */
+        template <class F>
+        void pull_slots(F apply_fnc);
+        bool pop(Change& c);
+        bool accept(int index, UInt32 seq);
+
+    private:
+        typedef std::atomic<unsigned long long> Slot;   // seq << 32 | value bits
+
+        UInt32  next_seq();
+        void    store_slot(int index, float val, UInt32 seq);
+        static bool is_older(UInt32 a, UInt32 b);
+
+        Slot                    _slot_arr[NBR_PARAM];
+        std::atomic<UInt32>     _dirty;
+        std::atomic<UInt32>     _seq;
+        SpscQueue<Change, QUEUE_CAP>
+                                _queue;
+        UInt32                  _applied_arr[NBR_PARAM];    // audio thread
+
+        /* no copies */
+        ParamHandoff(const ParamHandoff&);
+        ParamHandoff& operator=(const ParamHandoff&);
+    };
+
+    /*----------------------------- constructor -----------------------------*/
+    template <int NBR_PARAM, int QUEUE_CAP>
+    inline ParamHandoff<NBR_PARAM, QUEUE_CAP>::ParamHandoff()
+        : _dirty(0), _seq(0), _queue()
+    {
+        for (int i = 0; i < NBR_PARAM; ++i)
+        {
+            _slot_arr[i].store(0, std::memory_order_relaxed);
+            _applied_arr[i] = 0;
+        }
+    }
+
+    /*------------------------------- writers -------------------------------*/
+    template <int NBR_PARAM, int QUEUE_CAP>
+    inline void ParamHandoff<NBR_PARAM, QUEUE_CAP>::set(int index, float val)
+    {
+        assert(index >= 0 && index < NBR_PARAM);
+        store_slot(index, val, next_seq());
+    }
+
+    template <int NBR_PARAM, int QUEUE_CAP>
+    inline void ParamHandoff<NBR_PARAM, QUEUE_CAP>::set_at(int index, float val, int offset)
+    {
+        assert(index >= 0 && index < NBR_PARAM);
+        const UInt32 seq = next_seq();
+        const Change c = { index, val, offset, seq };
+        if (!_queue.push(c))
+        {
+            store_slot(index, val, seq);
+        }
+    }
+
+    /*-------------------------------- reader -------------------------------*/
+    template <int NBR_PARAM, int QUEUE_CAP>
+    template <class F>
+    inline void ParamHandoff<NBR_PARAM, QUEUE_CAP>::pull_slots(F apply_fnc)
+    {
+        UInt32 dirty = _dirty.exchange(0, std::memory_order_acquire);
+        for (int i = 0; dirty != 0; ++i, dirty >>= 1)
+        {
+            if ((dirty & 1U) != 0)
+            {
+                const unsigned long long packed = _slot_arr[i].load(std::memory_order_relaxed);
+                const UInt32 bits = static_cast<UInt32>(packed);
+                if (accept(i, static_cast<UInt32>(packed >> 32)))
+                {
+                    float val;
+                    memcpy(&val, &bits, sizeof(val));
+                    apply_fnc(i, val);
+                }
+            }
+        }
+    }
+
+    template <int NBR_PARAM, int QUEUE_CAP>
+    inline bool ParamHandoff<NBR_PARAM, QUEUE_CAP>::pop(Change& c)
+    {
+        return _queue.pop(c);
+    }
+
+    /* records seq as the newest change applied to the parameter */
+    template <int NBR_PARAM, int QUEUE_CAP>
+    inline bool ParamHandoff<NBR_PARAM, QUEUE_CAP>::accept(int index, UInt32 seq)
+    {
+        assert(index >= 0 && index < NBR_PARAM);
+        if (is_older(seq, _applied_arr[index]))
+        {
+            return false;
+        }
+        _applied_arr[index] = seq;
+        return true;
+    }
+
+    /*------------------------------- helpers -------------------------------*/
+    template <int NBR_PARAM, int QUEUE_CAP>
+    inline UInt32 ParamHandoff<NBR_PARAM, QUEUE_CAP>::next_seq()
+    {
+        return _seq.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    template <int NBR_PARAM, int QUEUE_CAP>
+    inline void ParamHandoff<NBR_PARAM, QUEUE_CAP>::store_slot(int index, float val, UInt32 seq)
+    {
+        UInt32 bits;
+        memcpy(&bits, &val, sizeof(bits));
+        _slot_arr[index].store((static_cast<unsigned long long>(seq) << 32) | bits, std::memory_order_relaxed);
+        _dirty.fetch_or(1U << index, std::memory_order_release);
+    }
+
+    /* the counter wraps around */
+    template <int NBR_PARAM, int QUEUE_CAP>
+    inline bool ParamHandoff<NBR_PARAM, QUEUE_CAP>::is_older(UInt32 a, UInt32 b)
+    {
+        return static_cast<Int32>(a - b) < 0;
+    }
+
+} // namespace rspl
+#endif // RSPL_PARAMHANDOFF_H
@@ -0,0 +1,276 @@
+/******************************************************************************
+    rspl_perfcounters.h - Header-only PerfCounters
+    Hardware performance counters for the benchmarks: instructions, core
+    cycles, L1 data cache read misses, last-level cache misses and branch
+    misses, counted in user space for the calling thread only. Tells a
+    compute-bound kernel (low IPC, few misses) from a memory-bound one.
+
+    Linux only, through perf_event_open(). Each event has its own
+    counter; when the PMU has fewer counters than events, the kernel
+    multiplexes them and the counts are scaled by enabled / running time.
+    An event the CPU or the kernel does not offer (VMs, containers,
+    perf_event_paranoid > 2) stays unavailable and get() returns -1;
+    open() fails only when none of them could be opened. Elsewhere
+    open() always fails.
+
+    PerfCounters pc;
+    if (pc.open()) { pc.start(); work(); pc.stop(); pc.get(PerfCounters::Event_INSTR); }
+******************************************************************************/
+
+#ifndef RSPL_PERFCOUNTERS_H
+#define RSPL_PERFCOUNTERS_H
+
+#include "rspl.h"
+#include <cassert>
+#include <cerrno>
+
+#if defined (__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <cstring>
+    #define rspl_PERFCOUNTERS_LINUX
+#endif
+
+namespace rspl {
+
+    class PerfCounters
+    {
+    public:
+        enum Event
+        {
+            Event_INSTR = 0,
+            Event_CYCLES,
+            Event_L1D_MISS,
+            Event_LLC_MISS,
+            Event_BRANCH_MISS,
+
+            Event_NBR_ELT
+        };
+
+        PerfCounters();
+        ~PerfCounters() { close(); }
+
+        bool open();
+        void close();
+        bool is_open() const;
+        bool is_available(Event event) const;
+        // errno of the first event that failed to open, 0 if none did
+        int get_err() const { return _err; }
+
+        inline void start();
+        inline void stop();
+
+        // Scaled count between the last start() and stop(), -1 if unknown
+        double get(Event event) const;
+
+        static const char* get_name(Event event);
+
+    private:
+        typedef unsigned long long Count;   // as read from the kernel
+
+        class Reading
+        {
+        public:
+            Count   _val;
+            Count   _enabled;
+            Count   _running;
+        };
+
+        inline bool read_event(int event, Reading& r) const;
+
+        int     _fd_arr [Event_NBR_ELT];
+        Reading _beg_arr [Event_NBR_ELT];
+        double  _cnt_arr [Event_NBR_ELT];
+        int     _err;
+
+        /* no copies, the descriptors are owned */
+        PerfCounters(const PerfCounters&);
+        PerfCounters& operator=(const PerfCounters&);
+    };
+
+    /*----------------------------- constructor -----------------------------*/
+    inline PerfCounters::PerfCounters()
+        : _err(0)
+    {
+        for (int e = 0; e < Event_NBR_ELT; ++e)
+        {
+            _fd_arr[e] = -1;
+            _beg_arr[e]._val = 0;
+            _beg_arr[e]._enabled = 0;
+            _beg_arr[e]._running = 0;
+            _cnt_arr[e] = -1;
+        }
+    }
+
+    /*------------------------------ open/close ------------------------------*/
+    inline bool PerfCounters::open()
+    {
+        close();
+        _err = 0;
+#if defined (rspl_PERFCOUNTERS_LINUX)
+        static const UInt32 type_arr[Event_NBR_ELT] =
+        {
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE
+        };
+        static const Count config_arr[Event_NBR_ELT] =
+        {
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_CACHE_L1D
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,     // generic event, mapped to the LLC
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for (int e = 0; e < Event_NBR_ELT; ++e)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type_arr[e];
+            attr.config = config_arr[e];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd < 0)
+            {
+                if (_err == 0)
+                {
+                    _err = errno;
+                }
+            }
+            else
+            {
+                _fd_arr[e] = static_cast<int>(fd);
+            }
+        }
+#else
+        _err = ENOSYS;
+#endif
+        return is_open();
+    }
+
+    inline void PerfCounters::close()
+    {
+        for (int e = 0; e < Event_NBR_ELT; ++e)
+        {
+#if defined (rspl_PERFCOUNTERS_LINUX)
+            if (_fd_arr[e] >= 0)
+            {
+                ::close(_fd_arr[e]);
+            }
+#endif
+            _fd_arr[e] = -1;
+            _cnt_arr[e] = -1;
+        }
+    }
+
+    inline bool PerfCounters::is_open() const
+    {
+        for (int e = 0; e < Event_NBR_ELT; ++e)
+        {
+            if (_fd_arr[e] >= 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool PerfCounters::is_available(Event event) const
+    {
+        assert(event >= 0 && event < Event_NBR_ELT);
+        return (_fd_arr[event] >= 0);
+    }
+
+    /*------------------------------ counting -------------------------------*/
+    /* the counters keep running totals; start() takes a baseline instead
+       of resetting them, as a reset leaves the enabled / running times */
+    inline void PerfCounters::start()
+    {
+#if defined (rspl_PERFCOUNTERS_LINUX)
+        for (int e = 0; e < Event_NBR_ELT; ++e)
+        {
+            if (_fd_arr[e] >= 0 && read_event(e, _beg_arr[e]))
+            {
+                ioctl(_fd_arr[e], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    inline void PerfCounters::stop()
+    {
+#if defined (rspl_PERFCOUNTERS_LINUX)
+        for (int e = Event_NBR_ELT - 1; e >= 0; --e)
+        {
+            if (_fd_arr[e] >= 0)
+            {
+                ioctl(_fd_arr[e], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (int e = 0; e < Event_NBR_ELT; ++e)
+        {
+            _cnt_arr[e] = -1;
+            Reading end;
+            if (_fd_arr[e] >= 0 && read_event(e, end))
+            {
+                const double val = static_cast<double>(end._val - _beg_arr[e]._val);
+                const double enabled = static_cast<double>(end._enabled - _beg_arr[e]._enabled);
+                const double running = static_cast<double>(end._running - _beg_arr[e]._running);
+                if (running > 0)
+                {
+                    _cnt_arr[e] = (running < enabled) ? val * enabled / running : val;
+                }
+            }
+        }
+#endif
+    }
+
+    inline double PerfCounters::get(Event event) const
+    {
+        assert(event >= 0 && event < Event_NBR_ELT);
+        return _cnt_arr[event];
+    }
+
+    inline bool PerfCounters::read_event(int event, Reading& r) const
+    {
+#if defined (rspl_PERFCOUNTERS_LINUX)
+        Count buf[3];
+        if (read(_fd_arr[event], buf, sizeof(buf)) == static_cast<ssize_t>(sizeof(buf)))
+        {
+            r._val = buf[0];
+            r._enabled = buf[1];
+            r._running = buf[2];
+            return true;
+        }
+#else
+        (void)event;
+        (void)r;
+#endif
+        return false;
+    }
+
+    inline const char* PerfCounters::get_name(Event event)
+    {
+        static const char* const name_arr[Event_NBR_ELT] =
+        {
+            "instructions", "cycles", "l1d_read_misses", "llc_misses", "branch_misses"
+        };
+        assert(event >= 0 && event < Event_NBR_ELT);
+        return name_arr[event];
+    }
+
+} // namespace rspl
+
+#endif // RSPL_PERFCOUNTERS_H
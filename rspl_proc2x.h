@@ -0,0 +1,30 @@
+/******************************************************************************
+    rspl_proc2x.h - Header-only Proc2xInterface
+    Insert point for user processing on the 2x rate signal. ResamplerFlt
+    and MixBusFlt run it right before their 2:1 decimation, so nonlinear
+    stages (shapers, saturation, FM feedback) reuse the oversampling that
+    is already paid for instead of adding their own up/down stage.
+    Voices feeding a MixBusFlt with a processor must be switched to the
+    oversampled path, see MixBusFlt::set_proc_2x().
+******************************************************************************/
+
+#ifndef RSPL_PROC2X_H
+#define RSPL_PROC2X_H
+
+namespace rspl {
+
+    class Proc2xInterface
+    {
+    public:
+        virtual ~Proc2xInterface() {}
+
+        /* data_ptr holds nbr_spl samples at twice the output rate and is
+           processed in place. Called from the audio thread. */
+        virtual void process_block_2x(float data_ptr[], long nbr_spl) = 0;
+
+        /* called when the owner clears its own state */
+        virtual void clear_buffers() {}
+    };
+
+} // namespace rspl
+#endif // RSPL_PROC2X_H
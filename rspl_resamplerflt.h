@@ -6,6 +6,14 @@
 #ifndef RSPL_RESAMPLERFLT_H
 #define RSPL_RESAMPLERFLT_H
 
+#include "rspl.h"
+#include "rspl_big_arrays.h"
+#include "rspl_basevoicestate.h"
+#include "rspl_downsampler2flt.h"
+#include "rspl_interp.h"
+#include "rspl_mipmap.h"
+#include "rspl_proc2x.h"
+#include "rspl_resamplerstats.h"
 #include <vector>
 #include <cstring>
 #include <cassert>
@@ -15,6 +23,7 @@ namespace rspl {
 
     class InterpPack;
     class MipMapFlt;
+    class Proc2xInterface;
 
     class ResamplerFlt
     {
@@ -29,16 +38,25 @@ namespace rspl {
         /* connections */
         void set_interp(const InterpPack& interp);
         void set_sample(const MipMapFlt& spl);
+        void swap_sample(const MipMapFlt& spl, long frame_stride, int nbr_frames,
+            const int* frame_map_ptr, float frame_pos);
         void remove_sample();
+        void set_frame_layout(long frame_stride, int nbr_frames, const int* frame_map_ptr = 0);
+        void set_proc_2x(Proc2xInterface* proc_ptr);
+        void set_force_ovrspl(bool force_flag);
 
         /* control */
         void set_pitch(long pitch);
         long get_pitch() const;
         void set_playback_pos(Int64 pos);
         Int64 get_playback_pos() const;
+        void set_frame_pos(float pos);
+        float get_frame_pos() const;
 
         /* render */
         void interpolate_block(float dest_ptr[], long nbr_spl);
+        void interpolate_block_add_2x(float dest_ptr[], long nbr_spl, float vol, float vol_step);
+        void interpolate_sample_add_2x(float dest_ptr[2], float vol);
         void clear_buffers();
 
     private:
@@ -47,11 +65,19 @@ namespace rspl {
         std::vector<float> _buf;
         const MipMapFlt* _mip_map_ptr;
         const InterpPack* _interp_ptr;
+        Proc2xInterface* _proc_2x_ptr;
         Downsampler2Flt    _dwnspl;
         BaseVoiceState     _voice_arr[VoiceInfo_NBR_ELT];
         long               _pitch;
         long               _buf_len;
         long               _fade_pos;
+        long               _frame_stride;   // level 0 distance between frames
+        int                _nbr_frames;
+        const int*         _frame_map_ptr;  // frame -> stored slot, 0 = identity
+        int                _frame;          // requested frame
+        int                _cur_frame;      // frame of the current voice
+        float              _morph_target;   // requested blend towards _frame + 1
+        bool               _force_ovrspl_flag;
         bool               _fade_flag;
         bool               _fade_needed_flag;
         bool               _can_use_flag;
@@ -59,8 +85,15 @@ namespace rspl {
         /* helpers */
         void   reset_pitch_cur_voice();
         void   fade_block(float dest_ptr[], long nbr_spl);
+        void   fade_block_add_2x(float dest_ptr[], long nbr_spl, float vol, float vol_step);
+        void   add_voice_ramp(float dest_ptr[], long nbr_spl_2x, BaseVoiceState& v, float vol, float vol_step);
         int    compute_table(long pitch);
+        bool   compute_ovrspl(long pitch) const;
         void   begin_mip_map_fading();
+        void   init_frame_ptr(BaseVoiceState& v);
+        long   get_frame_offset(int frame) const;
+        void   begin_morph_ramp(long nbr_spl);
+        void   end_morph_ramp();
 
         /* no copies */
         ResamplerFlt(const ResamplerFlt&);
@@ -69,9 +102,10 @@ namespace rspl {
 
     /*----------------------------- constructor -----------------------------*/
     inline ResamplerFlt::ResamplerFlt()
-        : _buf(), _mip_map_ptr(0), _interp_ptr(0), _dwnspl(), _voice_arr(),
+        : _buf(), _mip_map_ptr(0), _interp_ptr(0), _proc_2x_ptr(0), _dwnspl(), _voice_arr(),
         _pitch(0), _buf_len(128), _fade_pos(0),
-        _fade_flag(false), _fade_needed_flag(false), _can_use_flag(false)
+        _frame_stride(0), _nbr_frames(1), _frame_map_ptr(0), _frame(0), _cur_frame(0), _morph_target(0),
+        _force_ovrspl_flag(false), _fade_flag(false), _fade_needed_flag(false), _can_use_flag(false)
     {
         _dwnspl.set_coefs(DOWNSAMPLER_COEF_ARR);
         _buf.resize(_buf_len * 2);
@@ -92,8 +126,98 @@ namespace rspl {
         reset_pitch_cur_voice();
     }
 
+    /* Replaces a playing sample without a cut: pitch and position in the
+       cycle are kept, the new sample fades in with its frame layout and
+       frame position while the old one fades out, like a mip-map level
+       change. The old mip map and frame map must stay valid for
+       BaseVoiceState::FADE_LEN output samples. A crossfade in progress is
+       cut short. */
+    inline void ResamplerFlt::swap_sample(const MipMapFlt& spl, long frame_stride, int nbr_frames,
+        const int* frame_map_ptr, float frame_pos)
+    {
+        assert(_mip_map_ptr && _interp_ptr);
+        assert(spl.is_ready());
+        assert(_pitch < spl.get_nbr_tables() * (1L << NBR_BITS_PER_OCT));
+        assert(frame_stride >= 0);
+        assert(nbr_frames > 0);
+
+        BaseVoiceState& old_v = _voice_arr[VoiceInfo_FADEOUT];
+        BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT];
+        old_v = cur_v;                // keeps reading the old sample
+        old_v._morph_step = 0;
+
+        _mip_map_ptr = &spl;
+        _frame_stride = frame_stride;
+        _nbr_frames = nbr_frames;
+        _frame_map_ptr = frame_map_ptr;
+        set_frame_pos(frame_pos);
+        reset_pitch_cur_voice();      // level of the current pitch
+        const int d = old_v._table - cur_v._table;
+        cur_v._pos._all = shift_bidi(old_v._pos._all, d);
+        ResamplerStats::add_fade(old_v._table, cur_v._table);
+
+        _fade_needed_flag = false;
+        _fade_flag = true;
+        _fade_pos = 0;
+    }
+
     inline void ResamplerFlt::remove_sample() { _mip_map_ptr = 0; }
 
+    /* frame_stride is the level 0 distance between two frame starts, in
+       samples. A stride of 0 pins playback to the first cycle.
+       frame_map_ptr, if not 0, holds nbr_frames slot indexes (see
+       FrameStore) and must stay valid while it is in use. With a sample
+       set, the frame pointers are rebuilt at once; a crossfade in
+       progress is dropped, its old voice may point into another layout. */
+    inline void ResamplerFlt::set_frame_layout(long frame_stride, int nbr_frames, const int* frame_map_ptr)
+    {
+        assert(frame_stride >= 0);
+        assert(nbr_frames > 0);
+        _frame_stride = frame_stride;
+        _nbr_frames = nbr_frames;
+        _frame_map_ptr = frame_map_ptr;
+        if (_frame >= _nbr_frames)
+        {
+            _frame = _nbr_frames - 1;
+            _morph_target = 0;
+        }
+        if (_mip_map_ptr)
+        {
+            init_frame_ptr(_voice_arr[VoiceInfo_CURRENT]);
+            _fade_flag = false;
+        }
+        else
+        {
+            _fade_needed_flag |= (_frame != _cur_frame);
+        }
+    }
+
+    /* While a 2x processor is attached, negative pitches also take the
+       oversampled path (on level 0) so the processor always sees a 2x
+       stream. Pass 0 to detach. */
+    inline void ResamplerFlt::set_proc_2x(Proc2xInterface* proc_ptr)
+    {
+        _proc_2x_ptr = proc_ptr;
+        if (_mip_map_ptr)
+        {
+            const bool ovrspl_flag = compute_ovrspl(_pitch);
+            _fade_needed_flag |= (ovrspl_flag != _voice_arr[VoiceInfo_CURRENT]._ovrspl_flag);
+        }
+    }
+
+    /* Same path rule without a processor of its own: for voices feeding a
+       bus that runs one (see MixBusFlt::needs_ovrspl()). Otherwise the
+       normal path would reach the bus processor zero-stuffed. */
+    inline void ResamplerFlt::set_force_ovrspl(bool force_flag)
+    {
+        _force_ovrspl_flag = force_flag;
+        if (_mip_map_ptr)
+        {
+            const bool ovrspl_flag = compute_ovrspl(_pitch);
+            _fade_needed_flag |= (ovrspl_flag != _voice_arr[VoiceInfo_CURRENT]._ovrspl_flag);
+        }
+    }
+
     /*----------------------------- pitch ----------------------------------*/
     inline void ResamplerFlt::set_pitch(long pitch)
     {
@@ -105,8 +229,9 @@ namespace rspl {
 
         _pitch = pitch;
         const int new_table = compute_table(pitch);
-        const bool new_ovrspl = (pitch >= 0);
-        _fade_needed_flag = (new_table != cur_v._table) || (new_ovrspl != cur_v._ovrspl_flag);
+        const bool new_ovrspl = compute_ovrspl(pitch);
+        _fade_needed_flag = (new_table != cur_v._table) || (new_ovrspl != cur_v._ovrspl_flag)
+            || (_frame != _cur_frame);
 
         cur_v.compute_step(_pitch);
         if (_fade_flag) { old_v.compute_step(_pitch); }
@@ -131,12 +256,43 @@ namespace rspl {
         return (cur_v._pos._all << cur_v._table);
     }
 
+    /*------------------------------ frames --------------------------------*/
+    /* pos is in frames, 0 .. nbr_frames - 1. The fractional part blends
+       towards the next frame inside the same render, ramped over the next
+       interpolate_block() call. Moving to another frame pair crossfades
+       like a mip-map level change. */
+    inline void ResamplerFlt::set_frame_pos(float pos)
+    {
+        assert(pos >= 0);
+        const int last = _nbr_frames - 1;
+        int   frame = static_cast<int>(pos);
+        float morph = pos - static_cast<float>(frame);
+        if (frame >= last)
+        {
+            frame = last;
+            morph = 0;
+        }
+        _frame = frame;
+        _morph_target = morph;
+        _fade_needed_flag |= (_frame != _cur_frame);
+    }
+
+    inline float ResamplerFlt::get_frame_pos() const
+    {
+        return static_cast<float>(_frame) + _morph_target;
+    }
+
     /*---------------------------- helpers ---------------------------------*/
     inline int ResamplerFlt::compute_table(long pitch)
     {
         return (pitch >= 0) ? (pitch >> NBR_BITS_PER_OCT) : 0;
     }
 
+    inline bool ResamplerFlt::compute_ovrspl(long pitch) const
+    {
+        return (pitch >= 0 || _proc_2x_ptr != 0 || _force_ovrspl_flag);
+    }
+
     /* per?voice table / cycle / mask */
     inline void ResamplerFlt::reset_pitch_cur_voice()
     {
@@ -145,24 +301,75 @@ namespace rspl {
 
         cur._table = compute_table(_pitch);
         cur._table_len = _mip_map_ptr->get_lev_len(cur._table);
-        cur._table_ptr = _mip_map_ptr->use_table(cur._table);
-        cur._ovrspl_flag = (_pitch >= 0);
+        cur._ovrspl_flag = compute_ovrspl(_pitch);
 
         cur._cycle_len = static_cast<UInt32>(BASE_CYCLE_LEN >> cur._table);
         cur._cycle_mask = cur._cycle_len - 1U;
+        init_frame_ptr(cur);
 
         cur.compute_step(_pitch);
     }
 
+    /* frame offsets are scaled to the voice level, like the cycle length */
+    inline void ResamplerFlt::init_frame_ptr(BaseVoiceState& v)
+    {
+        const float* level_ptr = _mip_map_ptr->use_table(v._table);
+        const long   offset = get_frame_offset(_frame);
+        v._table_ptr = level_ptr + (offset >> v._table);
+        v._table_nxt_ptr = 0;
+        if (_frame + 1 < _nbr_frames && _frame_stride > 0)
+        {
+            /* frames sharing a slot need no morph */
+            const long offset_nxt = get_frame_offset(_frame + 1);
+            if (offset_nxt != offset)
+            {
+                v._table_nxt_ptr = level_ptr + (offset_nxt >> v._table);
+            }
+        }
+        v._morph = (v._table_nxt_ptr != 0) ? _morph_target : 0;
+        v._morph_step = 0;
+        _cur_frame = _frame;
+    }
+
+    /* level 0 offset of the frame data */
+    inline long ResamplerFlt::get_frame_offset(int frame) const
+    {
+        const long slot = (_frame_map_ptr != 0) ? _frame_map_ptr[frame] : frame;
+        return slot * _frame_stride;
+    }
+
+    inline void ResamplerFlt::begin_morph_ramp(long nbr_spl)
+    {
+        BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT];
+        if (cur_v._table_nxt_ptr != 0 && cur_v._morph != _morph_target)
+        {
+            const long nbr_interp = cur_v._ovrspl_flag ? nbr_spl * 2 : nbr_spl;
+            cur_v._morph_step = (_morph_target - cur_v._morph) / static_cast<float>(nbr_interp);
+        }
+    }
+
+    /* land exactly on the target, the ramp accumulates rounding */
+    inline void ResamplerFlt::end_morph_ramp()
+    {
+        BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT];
+        if (cur_v._table_nxt_ptr != 0)
+        {
+            cur_v._morph = _morph_target;
+            cur_v._morph_step = 0;
+        }
+    }
+
     inline void ResamplerFlt::begin_mip_map_fading()
     {
         BaseVoiceState& old_v = _voice_arr[VoiceInfo_FADEOUT];
         BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT];
 
         old_v = cur_v;                // copy incl. cycle data
+        old_v._morph_step = 0;
         reset_pitch_cur_voice();      // recompute cur_v for new table
         const int d = old_v._table - cur_v._table;
         cur_v._pos._all = shift_bidi(old_v._pos._all, d);
+        ResamplerStats::add_fade(old_v._table, cur_v._table);
 
         _fade_needed_flag = false;
         _fade_flag = true;
@@ -175,6 +382,9 @@ namespace rspl {
         assert(_mip_map_ptr && _interp_ptr && dest_ptr && nbr_spl > 0);
 
         if (_fade_needed_flag && !_fade_flag) { begin_mip_map_fading(); }
+        begin_morph_ramp(nbr_spl);
+        const BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT];
+        const UInt32 msw_beg = cur_v._pos._part._msw;
 
         long pos = 0;
         while (pos < nbr_spl)
@@ -190,53 +400,160 @@ namespace rspl {
             {
                 work = min(work, _buf_len);
                 _interp_ptr->interp_ovrspl(&_buf[0], work * 2, _voice_arr[VoiceInfo_CURRENT]);
+                if (_proc_2x_ptr) { _proc_2x_ptr->process_block_2x(&_buf[0], work * 2); }
                 _dwnspl.downsample_block(dest_ptr + pos, &_buf[0], work);
+                ResamplerStats::add_spl(ResamplerStats::Path_OVRSPL, cur_v._table, work);
             }
             else
             {
                 _interp_ptr->interp_norm(dest_ptr + pos, work, _voice_arr[VoiceInfo_CURRENT]);
                 _dwnspl.phase_block(dest_ptr + pos, dest_ptr + pos, work);
+                ResamplerStats::add_spl(ResamplerStats::Path_NORM, cur_v._table, work);
             }
             pos += work;
         }
+
+        ResamplerStats::add_seam(msw_beg, cur_v._pos._part._msw, cur_v._cycle_len);
+        end_morph_ramp();
     }
 
-    inline void ResamplerFlt::fade_block(float dest_ptr[], long n)
+    /* Shared bus mode: accumulates this voice into dest_ptr, a 2x rate
+       buffer of nbr_spl * 2 samples, and leaves decimation to the owner of
+       the bus (see MixBusFlt). vol ramps by vol_step per output sample.
+       The normal path lands on even samples only, which the downsampler
+       turns back into phase_block(). */
+    inline void ResamplerFlt::interpolate_block_add_2x(float dest_ptr[], long nbr_spl, float vol, float vol_step)
     {
-        const long n2 = n * 2;
-        const float vStep = 1.0f / (BaseVoiceState::FADE_LEN * 2);
-        const float v = _fade_pos * (vStep * 2);
-
-        BaseVoiceState& old_v = _voice_arr[VoiceInfo_FADEOUT];
-        BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT];
+        assert(_mip_map_ptr && _interp_ptr && dest_ptr && nbr_spl > 0);
 
-        memset(_buf.data(), 0, sizeof(_buf[0]) * n2);
+        if (_fade_needed_flag && !_fade_flag) { begin_mip_map_fading(); }
+        begin_morph_ramp(nbr_spl);
+        const BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT];
+        const UInt32 msw_beg = cur_v._pos._part._msw;
 
-        if (cur_v._ovrspl_flag && old_v._ovrspl_flag)
+        long pos = 0;
+        while (pos < nbr_spl)
         {
-            _interp_ptr->interp_ovrspl_ramp_add(_buf.data(), n2, cur_v, v, vStep);
-            _interp_ptr->interp_ovrspl_ramp_add(_buf.data(), n2, old_v, 1.0f - v, -vStep);
+            long work = nbr_spl - pos;
+            if (_proc_2x_ptr)
+            {
+                /* the processor sees the voice before its gain, as in
+                   interpolate_block(), so it renders through _buf */
+                work = min(work, _buf_len);
+                if (_fade_flag)
+                {
+                    work = min(work, BaseVoiceState::FADE_LEN - _fade_pos);
+                    memset(&_buf[0], 0, sizeof(_buf[0]) * work * 2);
+                    fade_block_add_2x(&_buf[0], work, 1.0f, 0.0f);
+                }
+                else
+                {
+                    _interp_ptr->interp_ovrspl(&_buf[0], work * 2, _voice_arr[VoiceInfo_CURRENT]);
+                    ResamplerStats::add_spl(ResamplerStats::Path_OVRSPL, cur_v._table, work);
+                }
+                const long work2 = work * 2;
+                _proc_2x_ptr->process_block_2x(&_buf[0], work2);
+
+                float* bus_ptr = dest_ptr + pos * 2;
+                const float step_2x = vol_step * 0.5f;
+                float v = vol;
+                for (long i = 0; i < work2; ++i)
+                {
+                    bus_ptr[i] += _buf[i] * v;
+                    v += step_2x;
+                }
+            }
+            else if (_fade_flag)
+            {
+                work = min(work, BaseVoiceState::FADE_LEN - _fade_pos);
+                fade_block_add_2x(dest_ptr + pos * 2, work, vol, vol_step);
+            }
+            else
+            {
+                add_voice_ramp(dest_ptr + pos * 2, work * 2, _voice_arr[VoiceInfo_CURRENT],
+                    vol, vol_step * 0.5f);
+                ResamplerStats::add_spl(
+                    cur_v._ovrspl_flag ? ResamplerStats::Path_OVRSPL : ResamplerStats::Path_NORM,
+                    cur_v._table, work);
+            }
+            vol += vol_step * work;
+            pos += work;
         }
-        else if (!cur_v._ovrspl_flag && old_v._ovrspl_flag)
+
+        ResamplerStats::add_seam(msw_beg, cur_v._pos._part._msw, cur_v._cycle_len);
+        end_morph_ramp();
+    }
+
+    /* One output sample in shared bus mode, for frame-based callers. The
+       steady state (no fade, no morph ramp, no processor) goes straight to
+       the voice kernel; anything else takes the block path with n = 1. */
+    inline void ResamplerFlt::interpolate_sample_add_2x(float dest_ptr[2], float vol)
+    {
+        assert(_mip_map_ptr && _interp_ptr && dest_ptr);
+
+        BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT];
+        if (_fade_needed_flag || _fade_flag || _proc_2x_ptr
+            || (cur_v._table_nxt_ptr != 0 && cur_v._morph != _morph_target))
         {
-            _interp_ptr->interp_norm_ramp_add(_buf.data(), n2, cur_v, v, vStep);
-            _interp_ptr->interp_ovrspl_ramp_add(_buf.data(), n2, old_v, 1.0f - v, -vStep);
+            interpolate_block_add_2x(dest_ptr, 1, vol, 0.0f);
         }
         else
         {
-            _interp_ptr->interp_ovrspl_ramp_add(_buf.data(), n2, cur_v, v, vStep);
-            _interp_ptr->interp_norm_ramp_add(_buf.data(), n2, old_v, 1.0f - v, -vStep);
+            const UInt32 msw_beg = cur_v._pos._part._msw;
+            add_voice_ramp(dest_ptr, 2, cur_v, vol, 0.0f);
+            ResamplerStats::add_spl(
+                cur_v._ovrspl_flag ? ResamplerStats::Path_OVRSPL : ResamplerStats::Path_NORM,
+                cur_v._table, 1);
+            ResamplerStats::add_seam(msw_beg, cur_v._pos._part._msw, cur_v._cycle_len);
         }
+    }
 
+    inline void ResamplerFlt::fade_block(float dest_ptr[], long n)
+    {
+        memset(_buf.data(), 0, sizeof(_buf[0]) * n * 2);
+        fade_block_add_2x(_buf.data(), n, 1.0f, 0.0f);
+        if (_proc_2x_ptr) { _proc_2x_ptr->process_block_2x(_buf.data(), n * 2); }
         _dwnspl.downsample_block(dest_ptr, _buf.data(), n);
+    }
+
+    /* crossfade gain times the voice gain, both linear over the chunk */
+    inline void ResamplerFlt::fade_block_add_2x(float dest_ptr[], long n, float vol, float vol_step)
+    {
+        const long n2 = n * 2;
+        const float fStep = 1.0f / BaseVoiceState::FADE_LEN;
+        const float f_beg = _fade_pos * fStep;
+        const float f_end = (_fade_pos + n) * fStep;
+        const float vol_end = vol + vol_step * n;
+
+        const float cur_beg = vol * f_beg;
+        const float old_beg = vol - cur_beg;
+        const float cur_step = (vol_end * f_end - cur_beg) / n2;
+        const float old_step = (vol_end * (1.0f - f_end) - old_beg) / n2;
+
+        add_voice_ramp(dest_ptr, n2, _voice_arr[VoiceInfo_CURRENT], cur_beg, cur_step);
+        add_voice_ramp(dest_ptr, n2, _voice_arr[VoiceInfo_FADEOUT], old_beg, old_step);
 
         _fade_pos += n;
         _fade_flag = (_fade_pos < BaseVoiceState::FADE_LEN);
+        ResamplerStats::add_spl(ResamplerStats::Path_FADE, _voice_arr[VoiceInfo_CURRENT]._table, n);
+    }
+
+    inline void ResamplerFlt::add_voice_ramp(float dest_ptr[], long n2, BaseVoiceState& v, float vol, float vol_step)
+    {
+        if (v._ovrspl_flag)
+        {
+            _interp_ptr->interp_ovrspl_ramp_add(dest_ptr, n2, v, vol, vol_step);
+        }
+        else
+        {
+            _interp_ptr->interp_norm_ramp_add(dest_ptr, n2, v, vol, vol_step);
+        }
     }
 
     inline void ResamplerFlt::clear_buffers()
     {
         _dwnspl.clear_buffers();
+        if (_proc_2x_ptr) { _proc_2x_ptr->clear_buffers(); }
         if (_mip_map_ptr) { reset_pitch_cur_voice(); }
         _fade_needed_flag = false;
         _fade_flag = false;
@@ -0,0 +1,245 @@
+/******************************************************************************
+    rspl_resamplerstats.h - Hot-path counters for ResamplerFlt
+    Build with RSPL_RESAMPLER_STATS defined to count, over all
+    ResamplerFlt instances, the samples rendered by each path (crossfade,
+    oversampled, normal), the crossfades started and how many of them
+    changed the mip-map level, the samples rendered per level and the
+    number of times the current voice wrapped around its cycle (the
+    masked seam).
+
+    Each thread counts into its own cache line aligned block, which only
+    that thread writes (plain load and store, no read-modify-write), so
+    audio threads rendering in parallel never contend on a counter.
+    read() sums the blocks; reset() records the current sums as the new
+    zero instead of writing into blocks other threads own. Any thread may
+    call both without locking. A snapshot is not atomic as a whole:
+    counters updated while it is taken may be off by one chunk relative
+    to each other.
+
+    A thread's first count allocates its block, once. The block goes
+    back to a free list when the thread exits and the next new thread
+    takes it over, counts included.
+
+    Without RSPL_RESAMPLER_STATS every hook is an empty inline function
+    and the counting compiles to nothing.
+******************************************************************************/
+
+#ifndef RSPL_RESAMPLERSTATS_H
+#define RSPL_RESAMPLERSTATS_H
+
+#include "rspl.h"
+#if defined (RSPL_RESAMPLER_STATS)
+#include <atomic>
+#endif
+
+namespace rspl {
+
+    class ResamplerStats
+    {
+    public:
+        enum Path { Path_FADE = 0, Path_OVRSPL, Path_NORM, Path_NBR_ELT };
+        enum { NBR_LEVELS = 16 };   // higher levels land in the last bin
+
+        class Snapshot
+        {
+        public:
+            long long   _nbr_spl [Path_NBR_ELT];
+            long long   _nbr_spl_level [NBR_LEVELS];
+            long long   _nbr_fades;
+            long long   _nbr_level_switches;
+            long long   _nbr_seam_crossings;
+        };
+
+        /* audio thread */
+        static inline void add_spl(Path path, int level, long nbr_spl);
+        static inline void add_fade(int old_level, int new_level);
+        static inline void add_seam(UInt32 msw_beg, UInt32 msw_end, UInt32 cycle_len);
+
+        /* any thread */
+        static inline void read(Snapshot& snap);
+        static inline void reset();
+
+#if defined (RSPL_RESAMPLER_STATS)
+    private:
+        enum { NBR_CNT = Path_NBR_ELT + NBR_LEVELS + 3 };
+        enum
+        {
+            Cnt_SPL = 0,
+            Cnt_SPL_LEVEL = Cnt_SPL + Path_NBR_ELT,
+            Cnt_FADES = Cnt_SPL_LEVEL + NBR_LEVELS,
+            Cnt_LEVEL_SWITCHES,
+            Cnt_SEAM_CROSSINGS
+        };
+
+        /* one per thread, linked once and never freed */
+        class alignas(64) Counters
+        {
+        public:
+            Counters() : _used_flag(true), _next_ptr(0)
+            {
+                for (int i = 0; i < NBR_CNT; ++i)
+                {
+                    _cnt_arr[i].store(0, std::memory_order_relaxed);
+                }
+            }
+            std::atomic<long long>  _cnt_arr [NBR_CNT];
+            std::atomic<bool>       _used_flag;
+            Counters*               _next_ptr;
+        };
+
+        /* claims a block for the calling thread, releases it on exit */
+        class ThreadSlot
+        {
+        public:
+            ThreadSlot() : _cnt_ptr(claim()) {}
+            ~ThreadSlot() { _cnt_ptr->_used_flag.store(false, std::memory_order_release); }
+            Counters* _cnt_ptr;
+        };
+
+        static std::atomic<Counters*>& use_head()
+        {
+            static std::atomic<Counters*> head(0);
+            return head;
+        }
+
+        /* sums at the last reset() */
+        static std::atomic<long long>* use_base()
+        {
+            static std::atomic<long long> base_arr[NBR_CNT];
+            return base_arr;
+        }
+
+        static Counters& use_counters()
+        {
+            static thread_local ThreadSlot slot;
+            return *slot._cnt_ptr;
+        }
+
+        static Counters* claim()
+        {
+            std::atomic<Counters*>& head = use_head();
+            for (Counters* c_ptr = head.load(std::memory_order_acquire); c_ptr != 0; c_ptr = c_ptr->_next_ptr)
+            {
+                bool used_flag = false;
+                if (c_ptr->_used_flag.compare_exchange_strong(used_flag, true, std::memory_order_acquire))
+                {
+                    return c_ptr;
+                }
+            }
+            Counters* c_ptr = new Counters;
+            c_ptr->_next_ptr = head.load(std::memory_order_relaxed);
+            while (!head.compare_exchange_weak(c_ptr->_next_ptr, c_ptr,
+                std::memory_order_release, std::memory_order_relaxed))
+            {
+                // _next_ptr was reloaded
+            }
+            return c_ptr;
+        }
+
+        /* the owning thread is the only writer */
+        static void bump(int cnt, long long val)
+        {
+            std::atomic<long long>& c = use_counters()._cnt_arr[cnt];
+            c.store(c.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+        }
+
+        static void sum(long long sum_arr[NBR_CNT])
+        {
+            for (int i = 0; i < NBR_CNT; ++i)
+            {
+                sum_arr[i] = 0;
+            }
+            for (Counters* c_ptr = use_head().load(std::memory_order_acquire); c_ptr != 0; c_ptr = c_ptr->_next_ptr)
+            {
+                for (int i = 0; i < NBR_CNT; ++i)
+                {
+                    sum_arr[i] += c_ptr->_cnt_arr[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+#endif  // RSPL_RESAMPLER_STATS
+    };
+
+#if defined (RSPL_RESAMPLER_STATS)
+
+    inline void ResamplerStats::add_spl(Path path, int level, long nbr_spl)
+    {
+        bump(Cnt_SPL + path, nbr_spl);
+        const int bin = (level < NBR_LEVELS - 1) ? level : NBR_LEVELS - 1;
+        bump(Cnt_SPL_LEVEL + bin, nbr_spl);
+    }
+
+    inline void ResamplerStats::add_fade(int old_level, int new_level)
+    {
+        bump(Cnt_FADES, 1);
+        if (old_level != new_level)
+        {
+            bump(Cnt_LEVEL_SWITCHES, 1);
+        }
+    }
+
+    /* msw values are the integer playback positions before and after the
+       chunk. The position only moves forward and 2^32 is a multiple of the
+       cycle length, so the unsigned distance stays valid across a wrap. */
+    inline void ResamplerStats::add_seam(UInt32 msw_beg, UInt32 msw_end, UInt32 cycle_len)
+    {
+        const UInt32 phase = msw_beg & (cycle_len - 1U);
+        const UInt32 nbr_cross = (phase + (msw_end - msw_beg)) / cycle_len;
+        if (nbr_cross > 0)
+        {
+            bump(Cnt_SEAM_CROSSINGS, nbr_cross);
+        }
+    }
+
+    inline void ResamplerStats::read(Snapshot& snap)
+    {
+        long long sum_arr[NBR_CNT];
+        sum(sum_arr);
+        const std::atomic<long long>* base_arr = use_base();
+        long long val_arr[NBR_CNT];
+        for (int i = 0; i < NBR_CNT; ++i)
+        {
+            val_arr[i] = sum_arr[i] - base_arr[i].load(std::memory_order_relaxed);
+        }
+
+        for (int p = 0; p < Path_NBR_ELT; ++p)
+        {
+            snap._nbr_spl[p] = val_arr[Cnt_SPL + p];
+        }
+        for (int l = 0; l < NBR_LEVELS; ++l)
+        {
+            snap._nbr_spl_level[l] = val_arr[Cnt_SPL_LEVEL + l];
+        }
+        snap._nbr_fades = val_arr[Cnt_FADES];
+        snap._nbr_level_switches = val_arr[Cnt_LEVEL_SWITCHES];
+        snap._nbr_seam_crossings = val_arr[Cnt_SEAM_CROSSINGS];
+    }
+
+    inline void ResamplerStats::reset()
+    {
+        long long sum_arr[NBR_CNT];
+        sum(sum_arr);
+        std::atomic<long long>* base_arr = use_base();
+        for (int i = 0; i < NBR_CNT; ++i)
+        {
+            base_arr[i].store(sum_arr[i], std::memory_order_relaxed);
+        }
+    }
+
+#else   // RSPL_RESAMPLER_STATS
+
+    inline void ResamplerStats::add_spl(Path, int, long) {}
+    inline void ResamplerStats::add_fade(int, int) {}
+    inline void ResamplerStats::add_seam(UInt32, UInt32, UInt32) {}
+
+    inline void ResamplerStats::read(Snapshot& snap)
+    {
+        snap = Snapshot();
+    }
+
+    inline void ResamplerStats::reset() {}
+
+#endif  // RSPL_RESAMPLER_STATS
+
+} // namespace rspl
+#endif // RSPL_RESAMPLERSTATS_H
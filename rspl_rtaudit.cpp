@@ -0,0 +1,234 @@
+/******************************************************************************
+    rspl_rtaudit.cpp - Real-time safety audit hooks
+    Replaces the global operator new/delete (plain, nothrow, sized and
+    C++17 aligned forms) and, on Linux, interposes pthread_mutex_lock.
+    Compiled to nothing unless RSPL_RT_AUDIT is defined. See
+    rspl_rtaudit.h.
+******************************************************************************/
+
+#include "rspl_rtaudit.h"
+
+#if defined (RSPL_RT_AUDIT)
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined (_WIN32)
+#include <malloc.h>
+#endif
+
+#if defined (__linux__)
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+namespace rspl {
+
+    namespace rt_audit_detail {
+
+        /* thread_local with a trivial type: no allocation on access */
+        static thread_local int  scope_depth = 0;
+        static std::atomic<long>   nbr_alloc(0);
+        static std::atomic<long>   nbr_free(0);
+        static std::atomic<long>   nbr_lock(0);
+        static std::atomic<size_t> last_alloc_size(0);
+        static std::atomic<bool>   abort_flag(false);
+
+    } // namespace rt_audit_detail
+
+    void RtAudit::enter() { ++rt_audit_detail::scope_depth; }
+    void RtAudit::leave() { --rt_audit_detail::scope_depth; }
+    bool RtAudit::is_in_scope() { return rt_audit_detail::scope_depth > 0; }
+
+    void RtAudit::note_alloc(size_t size)
+    {
+        if (!is_in_scope()) { return; }
+        rt_audit_detail::nbr_alloc.fetch_add(1, std::memory_order_relaxed);
+        rt_audit_detail::last_alloc_size.store(size, std::memory_order_relaxed);
+        if (rt_audit_detail::abort_flag.load(std::memory_order_relaxed)) { std::abort(); }
+    }
+
+    void RtAudit::note_free(void* ptr)
+    {
+        if (ptr == 0 || !is_in_scope()) { return; }
+        rt_audit_detail::nbr_free.fetch_add(1, std::memory_order_relaxed);
+        if (rt_audit_detail::abort_flag.load(std::memory_order_relaxed)) { std::abort(); }
+    }
+
+    void RtAudit::note_lock()
+    {
+        if (!is_in_scope()) { return; }
+        rt_audit_detail::nbr_lock.fetch_add(1, std::memory_order_relaxed);
+        if (rt_audit_detail::abort_flag.load(std::memory_order_relaxed)) { std::abort(); }
+    }
+
+    void RtAudit::set_abort_on_violation(bool flag)
+    {
+        rt_audit_detail::abort_flag.store(flag);
+    }
+
+    long RtAudit::get_nbr_alloc() { return rt_audit_detail::nbr_alloc.load(); }
+    long RtAudit::get_nbr_free()  { return rt_audit_detail::nbr_free.load(); }
+    long RtAudit::get_nbr_lock()  { return rt_audit_detail::nbr_lock.load(); }
+
+    long RtAudit::report(const char* name_0, FILE* stream_ptr)
+    {
+        const long nbr_alloc = rt_audit_detail::nbr_alloc.exchange(0);
+        const long nbr_free = rt_audit_detail::nbr_free.exchange(0);
+        const long nbr_lock = rt_audit_detail::nbr_lock.exchange(0);
+        if ((nbr_alloc > 0 || nbr_free > 0 || nbr_lock > 0) && stream_ptr != 0)
+        {
+            fprintf(stream_ptr,
+                "[rt-audit] %s: %ld allocation(s) (last %lu bytes), %ld deallocation(s), %ld lock(s) on the audio thread\n",
+                (name_0 != 0) ? name_0 : "?",
+                nbr_alloc,
+                static_cast<unsigned long>(rt_audit_detail::last_alloc_size.load()),
+                nbr_free,
+                nbr_lock);
+        }
+        return nbr_alloc + nbr_free + nbr_lock;
+    }
+
+    namespace rt_audit_detail {
+
+        static void* alloc_aligned(size_t size, size_t align) noexcept
+        {
+            if (size == 0) { size = 1; }
+            if (align < sizeof(void*)) { align = sizeof(void*); }
+#if defined (_WIN32)
+            return _aligned_malloc(size, align);
+#else
+            void* ptr = 0;
+            return (posix_memalign(&ptr, align, size) == 0) ? ptr : 0;
+#endif
+        }
+
+        /* the release helpers count the call and stay out of line: once
+           a hook is inlined into a delete expression, GCC pairs the
+           free() with the new and warns about a mismatch */
+#if defined (__GNUC__)
+        __attribute__((noinline))
+#endif
+        static void free_plain(void* ptr) noexcept
+        {
+            RtAudit::note_free(ptr);
+            std::free(ptr);
+        }
+
+#if defined (__GNUC__)
+        __attribute__((noinline))
+#endif
+        static void free_aligned(void* ptr) noexcept
+        {
+            RtAudit::note_free(ptr);
+#if defined (_WIN32)
+            _aligned_free(ptr);
+#else
+            std::free(ptr);
+#endif
+        }
+
+    } // namespace rt_audit_detail
+
+} // namespace rspl
+
+/*------------------------- global allocation hooks -------------------------*/
+void* operator new(size_t size)
+{
+    rspl::RtAudit::note_alloc(size);
+    void* ptr = std::malloc(size != 0 ? size : 1);
+    if (ptr == 0) { throw std::bad_alloc(); }
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    rspl::RtAudit::note_alloc(size);
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nt) noexcept
+{
+    return ::operator new(size, nt);
+}
+
+/* aligned forms, used for types with an alignment above the default
+   (alignas(32) SIMD buffers and the like) */
+void* operator new(size_t size, std::align_val_t align)
+{
+    rspl::RtAudit::note_alloc(size);
+    void* ptr = rspl::rt_audit_detail::alloc_aligned(size, static_cast<size_t>(align));
+    if (ptr == 0) { throw std::bad_alloc(); }
+    return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t align)
+{
+    return ::operator new(size, align);
+}
+
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    rspl::RtAudit::note_alloc(size);
+    return rspl::rt_audit_detail::alloc_aligned(size, static_cast<size_t>(align));
+}
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t& nt) noexcept
+{
+    return ::operator new(size, align, nt);
+}
+
+/* a free on the audio thread is as much a violation as an allocation:
+   both can take the allocator lock */
+void operator delete(void* ptr) noexcept                              { rspl::rt_audit_detail::free_plain(ptr); }
+void operator delete[](void* ptr) noexcept                            { rspl::rt_audit_detail::free_plain(ptr); }
+void operator delete(void* ptr, size_t) noexcept                      { rspl::rt_audit_detail::free_plain(ptr); }
+void operator delete[](void* ptr, size_t) noexcept                    { rspl::rt_audit_detail::free_plain(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept       { rspl::rt_audit_detail::free_plain(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept     { rspl::rt_audit_detail::free_plain(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept                              { rspl::rt_audit_detail::free_aligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept                            { rspl::rt_audit_detail::free_aligned(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept                      { rspl::rt_audit_detail::free_aligned(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept                    { rspl::rt_audit_detail::free_aligned(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept       { rspl::rt_audit_detail::free_aligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept     { rspl::rt_audit_detail::free_aligned(ptr); }
+
+/*---------------------------- lock interposition ---------------------------*/
+#if defined (__linux__)
+
+namespace rspl {
+    namespace rt_audit_detail {
+
+        typedef int (*LockFnc)(pthread_mutex_t*);
+
+        /* Resolved on first use, from any thread. Not a function-local
+           static: its guard may itself lock and land back here. Threads
+           racing on the first call all resolve the same address. */
+        static std::atomic<LockFnc> real_lock_fnc(0);
+
+    } // namespace rt_audit_detail
+} // namespace rspl
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex_ptr)
+{
+    using namespace rspl::rt_audit_detail;
+    LockFnc real_fnc = real_lock_fnc.load(std::memory_order_acquire);
+    if (real_fnc == 0)
+    {
+        real_fnc = reinterpret_cast<LockFnc>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        real_lock_fnc.store(real_fnc, std::memory_order_release);
+    }
+    rspl::RtAudit::note_lock();
+    return real_fnc(mutex_ptr);
+}
+
+#endif  // __linux__
+
+#endif  // RSPL_RT_AUDIT
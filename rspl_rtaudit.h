@@ -0,0 +1,77 @@
+/******************************************************************************
+    rspl_rtaudit.h - Real-time safety audit
+    Debug aid for the audio path. Build with RSPL_RT_AUDIT defined and
+    include rspl_rtaudit.cpp in exactly one translation unit (like
+    rspl_big_arrays.cpp). Code inside an RtAuditScope is then watched:
+    every global operator new and delete (aligned forms included) and,
+    on Linux, every pthread_mutex_lock made from that thread is counted.
+    Call RtAudit::report() from a non real-time thread to print and
+    reset the counters.
+
+    Lock interposition only sees calls that bind to our symbol, which is
+    the case when the audit TU is linked into the executable (tests,
+    command line tools), not always inside a plugin loaded by a host.
+
+    Without RSPL_RT_AUDIT, RtAuditScope is an empty object and costs
+    nothing.
+******************************************************************************/
+
+#ifndef RSPL_RTAUDIT_H
+#define RSPL_RTAUDIT_H
+
+#include <cstddef>
+#include <cstdio>
+
+namespace rspl {
+
+#if defined (RSPL_RT_AUDIT)
+
+    class RtAudit
+    {
+    public:
+        /* scope tracking, real-time safe */
+        static void enter();
+        static void leave();
+        static bool is_in_scope();
+
+        /* called by the hooks */
+        static void note_alloc(size_t size);
+        static void note_free(void* ptr);
+        static void note_lock();
+
+        /* abort() on the first violation, to get a stack in a debugger */
+        static void set_abort_on_violation(bool flag);
+
+        /* not real-time safe. Returns the number of violations since the
+           previous call. */
+        static long report(const char* name_0, FILE* stream_ptr = stderr);
+        static long get_nbr_alloc();
+        static long get_nbr_free();
+        static long get_nbr_lock();
+    };
+
+    class RtAuditScope
+    {
+    public:
+        RtAuditScope()  { RtAudit::enter(); }
+        ~RtAuditScope() { RtAudit::leave(); }
+    private:
+        RtAuditScope(const RtAuditScope&);
+        RtAuditScope& operator=(const RtAuditScope&);
+    };
+
+#else   // RSPL_RT_AUDIT
+
+    class RtAuditScope
+    {
+    public:
+        RtAuditScope() {}
+    private:
+        RtAuditScope(const RtAuditScope&);
+        RtAuditScope& operator=(const RtAuditScope&);
+    };
+
+#endif  // RSPL_RT_AUDIT
+
+} // namespace rspl
+#endif // RSPL_RTAUDIT_H
@@ -0,0 +1,81 @@
+/******************************************************************************
+    rspl_spscqueue.h - Header-only SpscQueue
+    Bounded lock-free queue for one producer thread and one consumer
+    thread. Neither side ever blocks or allocates: push() fails when the
+    queue is full and pop() fails when it is empty, and the caller decides
+    what to do (typically coalesce into the latest value).
+******************************************************************************/
+
+#ifndef RSPL_SPSCQUEUE_H
+#define RSPL_SPSCQUEUE_H
+
+#include <atomic>
+
+namespace rspl {
+
+    template <class T, int CAPACITY>
+    class SpscQueue
+    {
+    public:
+        enum { CAP = CAPACITY };
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of 2");
+
+        SpscQueue() : _data(), _write_pos(0), _read_pos(0) {}
+        ~SpscQueue() {}
+
+        /* producer thread */
+        bool push(const T& val);
+
+        /* consumer thread */
+        bool pop(T& val);
+
+        /* either side, approximate while the other side runs */
+        bool empty() const;
+
+    private:
+        T                     _data[CAPACITY];
+        std::atomic<unsigned> _write_pos;
+        std::atomic<unsigned> _read_pos;
+
+        /* no copies */
+        SpscQueue(const SpscQueue&);
+        SpscQueue& operator=(const SpscQueue&);
+    };
+
+    /*------------------------------- access --------------------------------*/
+    template <class T, int CAPACITY>
+    inline bool SpscQueue<T, CAPACITY>::push(const T& val)
+    {
+        const unsigned w = _write_pos.load(std::memory_order_relaxed);
+        const unsigned r = _read_pos.load(std::memory_order_acquire);
+        if (w - r >= static_cast<unsigned>(CAPACITY))
+        {
+            return false;
+        }
+        _data[w & (CAPACITY - 1)] = val;
+        _write_pos.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <class T, int CAPACITY>
+    inline bool SpscQueue<T, CAPACITY>::pop(T& val)
+    {
+        const unsigned r = _read_pos.load(std::memory_order_relaxed);
+        const unsigned w = _write_pos.load(std::memory_order_acquire);
+        if (r == w)
+        {
+            return false;
+        }
+        val = _data[r & (CAPACITY - 1)];
+        _read_pos.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <class T, int CAPACITY>
+    inline bool SpscQueue<T, CAPACITY>::empty() const
+    {
+        return _read_pos.load(std::memory_order_acquire) == _write_pos.load(std::memory_order_acquire);
+    }
+
+} // namespace rspl
+#endif // RSPL_SPSCQUEUE_H
@@ -1,16 +1,24 @@
 /******************************************************************************
     rspl_stopwatch.h - Header-only conversion of the StopWatch module.
-    
+
     This file combines:
       - StopWatch.h     [&#8203;:contentReference[oaicite:0]{index=0}]
       - StopWatch.hpp   [&#8203;:contentReference[oaicite:1]{index=1}]
       - StopWatch.cpp   [&#8203;:contentReference[oaicite:2]{index=2}]
-    
+
     This instrumentation class provides high-accuracy time interval measurements.
     On Mac OS it uses mach_absolute_time() (and Gestalt for clock speed),
-    on other systems it uses CPU cycle counters (via __rdtsc() on MSC or
-    __builtin_ia32_rdtsc() on GCC/Clang).
-    
+    on x86 it uses the CPU cycle counter (__rdtsc() on MSC or
+    __builtin_ia32_rdtsc() on GCC/Clang), elsewhere a monotonic clock
+    counting nanoseconds (clock_gettime() on Linux, std::chrono otherwise).
+    Define RSPL_STOPWATCH_USE_CLOCK_GETTIME to use clock_gettime() on x86
+    Linux too, e.g. on VMs where the TSC is not trustworthy.
+
+    get_clk() stays in native units. get_ns() converts them with a ratio
+    calibrated once against the monotonic clock, so figures can be
+    compared across machines. StopWatchStats accumulates repeated
+    measurements (min / median / p99) and ScopedStopWatch times a scope.
+
     Copyright (c) 2003 Laurent de Soras
     Distributed under the GNU Lesser General Public License, version 2.1 or later.
 *******************************************************************************/
@@ -18,18 +26,32 @@
 #ifndef RSPL_STOPWATCH_H
 #define RSPL_STOPWATCH_H
 
+#include "rspl.h"
 #include <cassert>
+#include <vector>
+#include <algorithm>
+#include <chrono>
 
 #if defined(__MACOS__)
     #include <mach/mach_time.h>
     #include <Gestalt.h>
     #include "def.h"
+    #define rspl_STOPWATCH_MACOS
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define rspl_STOPWATCH_TSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) \
+    && !(defined(__linux__) && defined(RSPL_STOPWATCH_USE_CLOCK_GETTIME))
+    #include <cpuid.h>
+    #define rspl_STOPWATCH_TSC
+#elif defined(__linux__)
+    #define rspl_STOPWATCH_CLOCK_GETTIME
+#else
+    #define rspl_STOPWATCH_CHRONO
 #endif
 
-#if defined(_MSC_VER)
-    #include <intrin.h>
-#elif defined(__GNUC__) || defined(__clang__)
-    // __builtin_ia32_rdtsc is available in these compilers.
+#if defined(__linux__)
+    #include <time.h>
 #endif
 
 namespace rspl {
@@ -49,7 +71,20 @@ public:
     // Returns the average clock per operation: get_clk() divided by (div_1 * div_2).
     inline double get_clk_per_op(long div_1, long div_2 = 1) const;
 
+    // Elapsed time in nanoseconds, and per operation.
+    inline double get_ns() const;
+    inline double get_ns_per_op(long div_1, long div_2 = 1) const;
+
+    // Nanoseconds per get_clk() unit, calibrated on first use.
+    static double get_ns_per_clk();
+    // False when the cycle counter may drift with frequency scaling.
+    static bool is_clk_invariant();
+    // Monotonic time in nanoseconds, independent from the counter above.
+    static Int64 read_monotonic_ns();
+
 private:
+    static inline Int64 read_counter();
+
     Int64 _start_time;
     Int64 _stop_time;
 #if defined(__MACOS__)
@@ -63,6 +98,45 @@ private:
     bool operator != (const StopWatch &other);
 };
 
+// Accumulates repeated measurements. add() does not allocate as long as
+// the capacity given to reserve() is not exceeded; the statistics sort a
+// copy and are meant for reporting, off the audio thread.
+class StopWatchStats
+{
+public:
+    StopWatchStats() : _val_arr() {}
+
+    void reserve(long nbr_val) { _val_arr.reserve(nbr_val); }
+    void clear() { _val_arr.clear(); }
+    void add(double val) { _val_arr.push_back(val); }
+
+    long get_nbr_val() const { return static_cast<long>(_val_arr.size()); }
+    double get_min() const;
+    double get_max() const;
+    double get_mean() const;
+    double get_median() const { return get_percentile(50); }
+    double get_p99() const { return get_percentile(99); }
+    double get_percentile(double pct) const;
+
+private:
+    std::vector<double> _val_arr;
+};
+
+// Adds the time spent in its scope, in nanoseconds, to a StopWatchStats.
+class ScopedStopWatch
+{
+public:
+    explicit ScopedStopWatch(StopWatchStats& stats) : _stats(stats), _sw() { _sw.start(); }
+    ~ScopedStopWatch() { _sw.stop(); _stats.add(_sw.get_ns()); }
+
+private:
+    StopWatchStats& _stats;
+    StopWatch       _sw;
+
+    ScopedStopWatch(const ScopedStopWatch &other);
+    ScopedStopWatch & operator = (const ScopedStopWatch &other);
+};
+
 //---------------------------------------------------------------------------
 // Inline Definitions
 //---------------------------------------------------------------------------
@@ -79,7 +153,7 @@ inline StopWatch::StopWatch()
 
     const long nbr_loops = 100 * 1000L;
     int a = 0;
-    
+
     // Get starting time from UpTime (converted to nanoseconds)
     const Nanoseconds nano_seconds_1 = AbsoluteToNanoseconds(UpTime());
     const double start_time_s =
@@ -104,66 +178,156 @@ inline StopWatch::StopWatch()
 #endif
 }
 
-#if defined(__MACOS__)
-inline void StopWatch::start()
+inline Int64 StopWatch::read_counter()
 {
-    _start_time = mach_absolute_time();
+#if defined(rspl_STOPWATCH_MACOS)
+    return mach_absolute_time();
+#elif defined(rspl_STOPWATCH_TSC) && defined(_MSC_VER)
+    return __rdtsc();
+#elif defined(rspl_STOPWATCH_TSC)
+    return __builtin_ia32_rdtsc();
+#else
+    return read_monotonic_ns();
+#endif
 }
 
-inline void StopWatch::stop()
-{
-    _stop_time = mach_absolute_time();
-}
-#else
-    #if defined(_MSC_VER)
 inline void StopWatch::start()
 {
-    _start_time = __rdtsc();
+    _start_time = read_counter();
 }
 
 inline void StopWatch::stop()
 {
-    _stop_time = __rdtsc();
+    _stop_time = read_counter();
 }
-    #elif defined(__GNUC__) || defined(__clang__)
-inline void StopWatch::start()
+
+inline Int64 StopWatch::get_clk() const
 {
-    _start_time = __builtin_ia32_rdtsc();
+#if defined(__MACOS__)
+    return ((_stop_time - _start_time) * _clk_mul);
+#else
+    return (_stop_time - _start_time);
+#endif
 }
 
-inline void StopWatch::stop()
+inline double StopWatch::get_clk_per_op(long div_1, long div_2) const
 {
-    _stop_time = __builtin_ia32_rdtsc();
+    assert(div_1 > 0);
+    assert(div_2 > 0);
+    const double nbr_clocks = static_cast<double>(get_clk());
+    const double glob_div = static_cast<double>(div_1) * static_cast<double>(div_2);
+    return (nbr_clocks / glob_div);
 }
-    #else
-inline void StopWatch::start()
+
+inline double StopWatch::get_ns() const
 {
-    _start_time = 0;
+    return static_cast<double>(get_clk()) * get_ns_per_clk();
 }
 
-inline void StopWatch::stop()
+inline double StopWatch::get_ns_per_op(long div_1, long div_2) const
 {
-    _stop_time = 0;
+    return get_clk_per_op(div_1, div_2) * get_ns_per_clk();
 }
+
+inline Int64 StopWatch::read_monotonic_ns()
+{
+#if defined(__linux__)
+    timespec ts;
+    #if defined(CLOCK_MONOTONIC_RAW)
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    #else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
     #endif
+    return static_cast<Int64>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#else
+    return static_cast<Int64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
 #endif
+}
 
-inline Int64 StopWatch::get_clk() const
+inline bool StopWatch::is_clk_invariant()
 {
-#if defined(__MACOS__)
-    return ((_stop_time - _start_time) * _clk_mul);
+#if defined(rspl_STOPWATCH_TSC) && defined(_MSC_VER)
+    int reg_arr[4];
+    __cpuid(reg_arr, 0x80000000);
+    if (static_cast<unsigned int>(reg_arr[0]) < 0x80000007U) { return false; }
+    __cpuid(reg_arr, 0x80000007);
+    return ((reg_arr[3] >> 8) & 1) != 0;
+#elif defined(rspl_STOPWATCH_TSC)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) { return false; }
+    return ((edx >> 8) & 1) != 0;
 #else
-    return (_stop_time - _start_time);
+    return true;
 #endif
 }
 
-inline double StopWatch::get_clk_per_op(long div_1, long div_2) const
+// Counters that already count nanoseconds need no calibration. The cycle
+// counters are timed against the monotonic clock over about 20 ms.
+inline double StopWatch::get_ns_per_clk()
 {
-    assert(div_1 > 0);
-    assert(div_2 > 0);
-    const double nbr_clocks = static_cast<double>(get_clk());
-    const double glob_div = static_cast<double>(div_1) * static_cast<double>(div_2);
-    return (nbr_clocks / glob_div);
+#if defined(rspl_STOPWATCH_TSC) || defined(rspl_STOPWATCH_MACOS)
+    static const double ns_per_clk = []()
+    {
+        const Int64 cal_ns = 20 * 1000 * 1000;
+        const Int64 ns_beg = read_monotonic_ns();
+        const Int64 clk_beg = read_counter();
+        Int64 ns_end = ns_beg;
+        while (ns_end - ns_beg < cal_ns)
+        {
+            ns_end = read_monotonic_ns();
+        }
+        const Int64 clk_end = read_counter();
+    #if defined(rspl_STOPWATCH_MACOS)
+        StopWatch sw;
+        const double clk_mul = sw._clk_mul;
+    #else
+        const double clk_mul = 1;
+    #endif
+        return static_cast<double>(ns_end - ns_beg) / (static_cast<double>(clk_end - clk_beg) * clk_mul);
+    }();
+    return ns_per_clk;
+#else
+    return 1.0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+
+inline double StopWatchStats::get_min() const
+{
+    assert(!_val_arr.empty());
+    return *std::min_element(_val_arr.begin(), _val_arr.end());
+}
+
+inline double StopWatchStats::get_max() const
+{
+    assert(!_val_arr.empty());
+    return *std::max_element(_val_arr.begin(), _val_arr.end());
+}
+
+inline double StopWatchStats::get_mean() const
+{
+    assert(!_val_arr.empty());
+    double sum = 0;
+    for (size_t i = 0; i < _val_arr.size(); ++i)
+    {
+        sum += _val_arr[i];
+    }
+    return sum / static_cast<double>(_val_arr.size());
+}
+
+// Nearest rank on a sorted copy
+inline double StopWatchStats::get_percentile(double pct) const
+{
+    assert(!_val_arr.empty());
+    assert(pct >= 0 && pct <= 100);
+    std::vector<double> tmp(_val_arr);
+    const long nbr_val = static_cast<long>(tmp.size());
+    long rank = static_cast<long>(pct * 0.01 * nbr_val + 0.5) - 1;
+    rank = std::max(0L, std::min(rank, nbr_val - 1));
+    std::nth_element(tmp.begin(), tmp.begin() + rank, tmp.end());
+    return tmp[rank];
 }
 
 } // namespace rspl
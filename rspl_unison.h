@@ -0,0 +1,413 @@
+/******************************************************************************
+    rspl_unison.h - Header-only UnisonFlt
+    Detuned unison stack: up to MAX_NBR_VOICES phases of the same cycle,
+    all reading one mip-map level and frame, summed with per-voice stereo
+    spread into a 2x rate bus and decimated once per channel.
+******************************************************************************/
+
+#ifndef RSPL_UNISON_H
+#define RSPL_UNISON_H
+
+#include "rspl.h"
+#include "rspl_big_arrays.h"
+#include "rspl_basevoicestate.h"
+#include "rspl_downsampler2flt.h"
+#include "rspl_interp.h"
+#include "rspl_mipmap.h"
+#include <vector>
+#include <cstring>
+#include <cassert>
+#include <cmath>
+
+namespace rspl {
+
+    class InterpPack;
+    class MipMapFlt;
+
+    class UnisonFlt
+    {
+    public:
+        enum { MAX_NBR_VOICES = InterpPack::MAX_STACK };
+        enum { NBR_BITS_PER_OCT = BaseVoiceState::NBR_BITS_PER_OCT };
+        enum { BASE_CYCLE_LEN = 1 << 11 };   // 2048-sample cycle
+
+        UnisonFlt();
+        ~UnisonFlt() {}
+
+        /* connections */
+        void set_interp(const InterpPack& interp);
+        void set_sample(const MipMapFlt& spl);
+        void remove_sample();
+        void set_frame_layout(long frame_stride, int nbr_frames, const int* frame_map_ptr = 0);
+
+        /* control */
+        void set_nbr_voices(int nbr_voices);
+        int  get_nbr_voices() const;
+        void set_detune(long detune);        // outer voice spread, pitch units
+        void set_spread(float spread);       // stereo width, 0..1
+        void set_pitch(long pitch);          // centre pitch
+        long get_pitch() const;
+        void set_frame(int frame);
+
+        /* render */
+        void interpolate_block(float dest_l_ptr[], float dest_r_ptr[], long nbr_spl);
+        void clear_buffers();
+
+    private:
+        enum VoiceInfo { VoiceInfo_CURRENT = 0, VoiceInfo_FADEOUT, VoiceInfo_NBR_ELT };
+
+        std::vector<float> _buf_l;           // 2x bus, left
+        std::vector<float> _buf_r;           // 2x bus, right
+        const MipMapFlt* _mip_map_ptr;
+        const InterpPack* _interp_ptr;
+        Downsampler2Flt    _dwnspl_l;
+        Downsampler2Flt    _dwnspl_r;
+        BaseVoiceState     _voice_arr[VoiceInfo_NBR_ELT][MAX_NBR_VOICES];
+        double             _ratio_arr[MAX_NBR_VOICES];   // step relative to top voice
+        float              _pan_l_arr[MAX_NBR_VOICES];
+        float              _pan_r_arr[MAX_NBR_VOICES];
+        int                _nbr_voices;
+        long               _pitch;
+        long               _detune;
+        float              _spread;
+        long               _frame_stride;    // level 0 distance between frames
+        int                _nbr_frames;
+        const int*         _frame_map_ptr;   // frame -> stored slot, 0 = identity
+        int                _frame;           // requested frame
+        int                _cur_frame;       // frame of the current voice set
+        long               _buf_len;
+        long               _fade_pos;
+        bool               _fade_flag;
+        bool               _fade_needed_flag;
+
+        /* helpers */
+        long   compute_top_pitch() const;
+        int    compute_table(long pitch) const;
+        void   update_voice_layout();
+        void   init_voice_table(BaseVoiceState& v, int table, bool ovrspl_flag, int frame) const;
+        void   init_voice_phase(BaseVoiceState& v, int voice) const;
+        void   reset_cur_voices();
+        void   compute_steps(int voice_set);
+        void   begin_mip_map_fading();
+        void   add_voices(int voice_set, long nbr_spl_2x, float vol, float vol_step);
+        void   render_block(float dest_l_ptr[], float dest_r_ptr[], long nbr_spl);
+
+        /* no copies */
+        UnisonFlt(const UnisonFlt&);
+        UnisonFlt& operator=(const UnisonFlt&);
+    };
+
+    /*----------------------------- constructor -----------------------------*/
+    inline UnisonFlt::UnisonFlt()
+        : _buf_l(), _buf_r(), _mip_map_ptr(0), _interp_ptr(0), _dwnspl_l(), _dwnspl_r(),
+        _voice_arr(), _nbr_voices(1), _pitch(0), _detune(0), _spread(0),
+        _frame_stride(0), _nbr_frames(1), _frame_map_ptr(0), _frame(0), _cur_frame(0),
+        _buf_len(128), _fade_pos(0), _fade_flag(false), _fade_needed_flag(false)
+    {
+        _dwnspl_l.set_coefs(DOWNSAMPLER_COEF_ARR);
+        _dwnspl_r.set_coefs(DOWNSAMPLER_COEF_ARR);
+        _buf_l.resize(_buf_len * 2);
+        _buf_r.resize(_buf_len * 2);
+        update_voice_layout();
+    }
+
+    /*------------------------------ wiring --------------------------------*/
+    inline void UnisonFlt::set_interp(const InterpPack& interp)
+    {
+        _interp_ptr = &interp;
+    }
+
+    inline void UnisonFlt::set_sample(const MipMapFlt& spl)
+    {
+        assert(spl.is_ready());
+        _mip_map_ptr = &spl;
+        _pitch = 0;
+        _fade_flag = false;
+        reset_cur_voices();
+        for (int k = 0; k < MAX_NBR_VOICES; ++k)
+        {
+            init_voice_phase(_voice_arr[VoiceInfo_CURRENT][k], k);
+        }
+    }
+
+    inline void UnisonFlt::remove_sample() { _mip_map_ptr = 0; }
+
+    /* frame_stride is the level 0 distance between two frame starts, in
+       samples. A stride of 0 pins playback to the first cycle. The frame
+       map works as in ResamplerFlt::set_frame_layout(). With a sample
+       set, the voice tables are rebuilt at once and a crossfade in
+       progress is dropped. */
+    inline void UnisonFlt::set_frame_layout(long frame_stride, int nbr_frames, const int* frame_map_ptr)
+    {
+        assert(frame_stride >= 0);
+        assert(nbr_frames > 0);
+        _frame_stride = frame_stride;
+        _nbr_frames = nbr_frames;
+        _frame_map_ptr = frame_map_ptr;
+        _frame = min(_frame, _nbr_frames - 1);
+        if (_mip_map_ptr)
+        {
+            reset_cur_voices();
+            _fade_needed_flag = false;
+            _fade_flag = false;
+        }
+        else
+        {
+            _fade_needed_flag |= (_frame != _cur_frame);
+        }
+    }
+
+    /*----------------------------- control --------------------------------*/
+    inline void UnisonFlt::set_nbr_voices(int nbr_voices)
+    {
+        assert(nbr_voices > 0);
+        assert(nbr_voices <= MAX_NBR_VOICES);
+
+        /* voices joining the stack take the table of voice 0 and their own
+           phase offset, in both the current and the fade-out set */
+        for (int k = _nbr_voices; k < nbr_voices; ++k)
+        {
+            for (int s = 0; s < VoiceInfo_NBR_ELT; ++s)
+            {
+                BaseVoiceState& v = _voice_arr[s][k];
+                v = _voice_arr[s][0];
+                init_voice_phase(v, k);
+            }
+        }
+        _nbr_voices = nbr_voices;
+        update_voice_layout();
+        if (_mip_map_ptr) { set_pitch(_pitch); }
+    }
+
+    inline int UnisonFlt::get_nbr_voices() const { return _nbr_voices; }
+
+    inline void UnisonFlt::set_detune(long detune)
+    {
+        assert(detune >= 0);
+        assert(detune <= (1L << NBR_BITS_PER_OCT));
+        _detune = detune;
+        update_voice_layout();
+        if (_mip_map_ptr) { set_pitch(_pitch); }
+    }
+
+    inline void UnisonFlt::set_spread(float spread)
+    {
+        assert(spread >= 0);
+        assert(spread <= 1);
+        _spread = spread;
+        update_voice_layout();
+    }
+
+    inline void UnisonFlt::set_pitch(long pitch)
+    {
+        assert(_mip_map_ptr && _interp_ptr);
+
+        const BaseVoiceState& cur_v = _voice_arr[VoiceInfo_CURRENT][0];
+
+        _pitch = pitch;
+        const long top_pitch = compute_top_pitch();
+        assert(top_pitch < _mip_map_ptr->get_nbr_tables() * (1L << NBR_BITS_PER_OCT));
+
+        const int  new_table = compute_table(top_pitch);
+        const bool new_ovrspl = (top_pitch >= 0);
+        _fade_needed_flag = (new_table != cur_v._table)
+            || (new_ovrspl != cur_v._ovrspl_flag)
+            || (_frame != _cur_frame);
+
+        compute_steps(VoiceInfo_CURRENT);
+        if (_fade_flag) { compute_steps(VoiceInfo_FADEOUT); }
+    }
+
+    inline long UnisonFlt::get_pitch() const { return _pitch; }
+
+    inline void UnisonFlt::set_frame(int frame)
+    {
+        assert(frame >= 0);
+        frame = min(frame, _nbr_frames - 1);
+        _frame = frame;
+        _fade_needed_flag |= (_frame != _cur_frame);
+    }
+
+    /*---------------------------- helpers ---------------------------------*/
+    /* The whole stack plays the level required by its highest voice, so
+       no voice aliases and the lower ones are at most slightly darker. */
+    inline long UnisonFlt::compute_top_pitch() const
+    {
+        return (_nbr_voices > 1) ? _pitch + _detune / 2 : _pitch;
+    }
+
+    inline int UnisonFlt::compute_table(long pitch) const
+    {
+        return (pitch >= 0) ? (pitch >> NBR_BITS_PER_OCT) : 0;
+    }
+
+    /* Detune ratios and pan gains only change at control rate; the exp()
+       calls are paid here instead of once per voice in set_pitch(). */
+    inline void UnisonFlt::update_voice_layout()
+    {
+        const float norm = 1.0f / static_cast<float>(sqrt(static_cast<double>(_nbr_voices)));
+        const double half_detune = _detune * 0.5 / static_cast<double>(1L << NBR_BITS_PER_OCT);
+
+        for (int k = 0; k < _nbr_voices; ++k)
+        {
+            const double pos = (_nbr_voices > 1)
+                ? 2.0 * k / static_cast<double>(_nbr_voices - 1) - 1.0
+                : 0.0;
+            _ratio_arr[k] = exp((pos - 1.0) * half_detune * LN2);
+
+            /* alternate sides so neighbouring detune values are split */
+            const double pan = ((k & 1) != 0 ? -pos : pos) * _spread;
+            const double angle = (pan + 1.0) * (PI * 0.25);
+            _pan_l_arr[k] = norm * static_cast<float>(cos(angle));
+            _pan_r_arr[k] = norm * static_cast<float>(sin(angle));
+        }
+        if (_nbr_voices == 1)
+        {
+            _ratio_arr[0] = 1.0;
+        }
+    }
+
+    inline void UnisonFlt::init_voice_table(BaseVoiceState& v, int table, bool ovrspl_flag, int frame) const
+    {
+        assert(_mip_map_ptr);
+
+        v._table = table;
+        v._table_len = _mip_map_ptr->get_lev_len(table);
+        const long slot = (_frame_map_ptr != 0) ? _frame_map_ptr[frame] : frame;
+        v._table_ptr = _mip_map_ptr->use_table(table) + ((slot * _frame_stride) >> table);
+        v._ovrspl_flag = ovrspl_flag;
+
+        v._cycle_len = static_cast<UInt32>(BASE_CYCLE_LEN >> table);
+        v._cycle_mask = v._cycle_len - 1U;
+    }
+
+    /* Fixed, well spread start phases (golden ratio sequence); voice 0
+       starts at 0 so a single voice matches ResamplerFlt. */
+    inline void UnisonFlt::init_voice_phase(BaseVoiceState& v, int voice) const
+    {
+        const double golden = 0.61803398874989484820;
+        const double frac = voice * golden - floor(voice * golden);
+        v._pos._all = static_cast<Int64>(frac * v._cycle_len * 4294967296.0);
+    }
+
+    inline void UnisonFlt::reset_cur_voices()
+    {
+        const long top_pitch = compute_top_pitch();
+        const int  table = compute_table(top_pitch);
+        const bool ovrspl_flag = (top_pitch >= 0);
+
+        for (int k = 0; k < MAX_NBR_VOICES; ++k)
+        {
+            BaseVoiceState& v = _voice_arr[VoiceInfo_CURRENT][k];
+            const int d = v._table - table;
+            init_voice_table(v, table, ovrspl_flag, _frame);
+            v._pos._all = shift_bidi(v._pos._all, d);
+        }
+        _cur_frame = _frame;
+        compute_steps(VoiceInfo_CURRENT);
+    }
+
+    inline void UnisonFlt::compute_steps(int voice_set)
+    {
+        BaseVoiceState* v_arr = _voice_arr[voice_set];
+
+        v_arr[0].compute_step(compute_top_pitch());
+        const double top_step = static_cast<double>(v_arr[0]._step._all);
+        for (int k = 0; k < _nbr_voices; ++k)
+        {
+            v_arr[k]._step._all = static_cast<Int64>(top_step * _ratio_arr[k]);
+        }
+    }
+
+    inline void UnisonFlt::begin_mip_map_fading()
+    {
+        BaseVoiceState* old_arr = _voice_arr[VoiceInfo_FADEOUT];
+        BaseVoiceState* cur_arr = _voice_arr[VoiceInfo_CURRENT];
+
+        for (int k = 0; k < MAX_NBR_VOICES; ++k)
+        {
+            old_arr[k] = cur_arr[k];
+        }
+        reset_cur_voices();
+        compute_steps(VoiceInfo_FADEOUT);
+
+        _fade_needed_flag = false;
+        _fade_flag = true;
+        _fade_pos = 0;
+    }
+
+    /* the whole set shares table and path, so it renders as one stack */
+    inline void UnisonFlt::add_voices(int voice_set, long n2, float vol, float vol_step)
+    {
+        BaseVoiceState* v_arr = _voice_arr[voice_set];
+        if (v_arr[0]._ovrspl_flag)
+        {
+            _interp_ptr->interp_ovrspl_stack_add(&_buf_l[0], &_buf_r[0], n2, v_arr, _nbr_voices,
+                vol, vol_step, _pan_l_arr, _pan_r_arr);
+        }
+        else
+        {
+            _interp_ptr->interp_norm_stack_add(&_buf_l[0], &_buf_r[0], n2, v_arr, _nbr_voices,
+                vol, vol_step, _pan_l_arr, _pan_r_arr);
+        }
+    }
+
+    /*---------------------------- rendering --------------------------------*/
+    inline void UnisonFlt::interpolate_block(float dest_l_ptr[], float dest_r_ptr[], long nbr_spl)
+    {
+        assert(_mip_map_ptr && _interp_ptr && dest_l_ptr && dest_r_ptr && nbr_spl > 0);
+
+        if (_fade_needed_flag && !_fade_flag) { begin_mip_map_fading(); }
+
+        long pos = 0;
+        while (pos < nbr_spl)
+        {
+            long work = min(nbr_spl - pos, _buf_len);
+            if (_fade_flag)
+            {
+                work = min(work, BaseVoiceState::FADE_LEN - _fade_pos);
+            }
+            render_block(dest_l_ptr + pos, dest_r_ptr + pos, work);
+            pos += work;
+        }
+    }
+
+    /* Both paths share the 2x bus: normal path voices are written on even
+       samples only, which downsample_block() turns into phase_block(). */
+    inline void UnisonFlt::render_block(float dest_l_ptr[], float dest_r_ptr[], long n)
+    {
+        const long n2 = n * 2;
+
+        memset(&_buf_l[0], 0, sizeof(_buf_l[0]) * n2);
+        memset(&_buf_r[0], 0, sizeof(_buf_r[0]) * n2);
+
+        if (_fade_flag)
+        {
+            const float vStep = 1.0f / (BaseVoiceState::FADE_LEN * 2);
+            const float v = _fade_pos * (vStep * 2);
+            add_voices(VoiceInfo_CURRENT, n2, v, vStep);
+            add_voices(VoiceInfo_FADEOUT, n2, 1.0f - v, -vStep);
+
+            _fade_pos += n;
+            _fade_flag = (_fade_pos < BaseVoiceState::FADE_LEN);
+        }
+        else
+        {
+            add_voices(VoiceInfo_CURRENT, n2, 1.0f, 0.0f);
+        }
+
+        _dwnspl_l.downsample_block(dest_l_ptr, &_buf_l[0], n);
+        _dwnspl_r.downsample_block(dest_r_ptr, &_buf_r[0], n);
+    }
+
+    inline void UnisonFlt::clear_buffers()
+    {
+        _dwnspl_l.clear_buffers();
+        _dwnspl_r.clear_buffers();
+        if (_mip_map_ptr) { reset_cur_voices(); }
+        _fade_needed_flag = false;
+        _fade_flag = false;
+    }
+
+} // namespace rspl
+#endif // RSPL_UNISON_H
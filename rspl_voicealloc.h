@@ -0,0 +1,335 @@
+/******************************************************************************
+    rspl_voicealloc.h - Header-only VoiceAlloc
+    Note to voice allocation for a fixed pool of NBR_VOICES voices, with
+    the linear attack / release envelope that drives it. The owner keeps
+    the voices' renderers (resamplers) in a parallel array and restarts
+    one whenever note_on(), advance() or end_ramp() says so.
+
+    A new note takes a free voice, else steals: the quietest releasing
+    voice, then the oldest one. A taken voice fades out over the steal
+    length and the note waits on it as its pending note. A note played
+    again while it sounds restarts its own voice the same way.
+
+    No allocation, audio thread only.
+******************************************************************************/
+
+#ifndef RSPL_VOICEALLOC_H
+#define RSPL_VOICEALLOC_H
+
+#include "rspl.h"
+#include <cassert>
+
+namespace rspl {
+
+    class VoiceSlot
+    {
+    public:
+        enum Stage
+        {
+            Stage_IDLE = 0,
+            Stage_ATTACK,
+            Stage_SUSTAIN,
+            Stage_RELEASE
+        };
+
+        VoiceSlot()
+            : _note(-1), _gain(0), _stage(Stage_IDLE), _env(0), _env_step(0), _env_left(0),
+            _stamp(0), _pending_note(-1), _pending_gain(0) {}
+
+        bool is_active() const { return _stage != Stage_IDLE; }
+
+        int     _note;
+        float   _gain;          // velocity
+        Stage   _stage;
+        float   _env;           // linear ramp, 0..1
+        float   _env_step;      // per sample
+        int     _env_left;      // samples left in the current ramp
+        UInt32  _stamp;         // allocation order, for stealing
+        int     _pending_note;  // note waiting for a steal fade, -1 if none
+        float   _pending_gain;
+    };
+
+    template <int NBR_VOICES>
+    class VoiceAlloc
+    {
+    public:
+        enum { NBR_VOICES_MAX = NBR_VOICES };
+        static_assert(NBR_VOICES > 0, "at least one voice");
+
+        VoiceAlloc();
+        ~VoiceAlloc() {}
+
+        /* in samples, all > 0 */
+        void set_ramp_len(int attack_len, int release_len, int steal_len);
+
+        /* Returns the voice that starts now, or -1 when the note waits for
+           a steal fade. */
+        int note_on(int note, float gain);
+        void note_off(int note);
+
+        /* Moves the envelope of voice v nbr_spl samples into its current
+           ramp, at most to its end. Returns true when the voice restarts
+           with its pending note. */
+        bool advance(int v, int nbr_spl);
+        bool end_ramp(int v);
+
+        void kill(int v);
+        void kill_all();
+
+        int find_voice_to_steal() const;
+        bool is_any_active() const;
+
+        VoiceSlot& use_slot(int v);
+        const VoiceSlot& use_slot(int v) const;
+
+    private:
+        void start(int v, int note, float gain);
+        static void begin_ramp(VoiceSlot& s, VoiceSlot::Stage stage, float target, int len);
+        static bool is_older(const VoiceSlot& a, const VoiceSlot& b);
+
+        VoiceSlot   _slot_arr[NBR_VOICES];
+        UInt32      _counter;
+        int         _attack_len;
+        int         _release_len;
+        int         _steal_len;
+
+        /* no copies */
+        VoiceAlloc(const VoiceAlloc&);
+        VoiceAlloc& operator=(const VoiceAlloc&);
+    };
+
+    /*----------------------------- constructor -----------------------------*/
+    template <int NBR_VOICES>
+    inline VoiceAlloc<NBR_VOICES>::VoiceAlloc()
+        : _slot_arr(), _counter(0), _attack_len(44), _release_len(441), _steal_len(88)
+    {
+    }
+
+    template <int NBR_VOICES>
+    inline void VoiceAlloc<NBR_VOICES>::set_ramp_len(int attack_len, int release_len, int steal_len)
+    {
+        assert(attack_len > 0 && release_len > 0 && steal_len > 0);
+        _attack_len = attack_len;
+        _release_len = release_len;
+        _steal_len = steal_len;
+    }
+
+    /*-------------------------------- notes --------------------------------*/
+    template <int NBR_VOICES>
+    inline int VoiceAlloc<NBR_VOICES>::note_on(int note, float gain)
+    {
+        /* retriggered notes restart their own voice */
+        int v = -1;
+        for (int i = 0; i < NBR_VOICES && v < 0; ++i)
+        {
+            const VoiceSlot& s = _slot_arr[i];
+            if (s.is_active() && s._pending_note < 0 && s._note == note
+                && s._stage != VoiceSlot::Stage_RELEASE)
+            {
+                v = i;
+            }
+        }
+        if (v < 0)
+        {
+            v = find_voice_to_steal();
+        }
+
+        VoiceSlot& s = _slot_arr[v];
+        if (!s.is_active())
+        {
+            start(v, note, gain);
+            return v;
+        }
+
+        s._pending_note = note;
+        s._pending_gain = gain;
+        if (s._stage != VoiceSlot::Stage_RELEASE || s._env_left > _steal_len)
+        {
+            begin_ramp(s, VoiceSlot::Stage_RELEASE, 0, _steal_len);
+        }
+        return -1;
+    }
+
+    template <int NBR_VOICES>
+    inline void VoiceAlloc<NBR_VOICES>::note_off(int note)
+    {
+        for (int i = 0; i < NBR_VOICES; ++i)
+        {
+            VoiceSlot& s = _slot_arr[i];
+            if (s._pending_note == note)
+            {
+                s._pending_note = -1;
+            }
+            else if (s.is_active() && s._stage != VoiceSlot::Stage_RELEASE && s._note == note)
+            {
+                begin_ramp(s, VoiceSlot::Stage_RELEASE, 0, _release_len);
+            }
+        }
+    }
+
+    /*------------------------------ envelope -------------------------------*/
+    template <int NBR_VOICES>
+    inline bool VoiceAlloc<NBR_VOICES>::advance(int v, int nbr_spl)
+    {
+        VoiceSlot& s = _slot_arr[v];
+        if (s._stage == VoiceSlot::Stage_SUSTAIN || !s.is_active())
+        {
+            return false;
+        }
+        assert(nbr_spl > 0 && nbr_spl <= s._env_left);
+        s._env += s._env_step * static_cast<float>(nbr_spl);
+        s._env_left -= nbr_spl;
+        return (s._env_left == 0) ? end_ramp(v) : false;
+    }
+
+    /* the attack lands on the sustain level, a release ends the voice or
+       hands it to its pending note */
+    template <int NBR_VOICES>
+    inline bool VoiceAlloc<NBR_VOICES>::end_ramp(int v)
+    {
+        VoiceSlot& s = _slot_arr[v];
+        s._env_step = 0;
+        if (s._stage == VoiceSlot::Stage_ATTACK)
+        {
+            s._env = 1;
+            s._stage = VoiceSlot::Stage_SUSTAIN;
+        }
+        else if (s._pending_note >= 0)
+        {
+            start(v, s._pending_note, s._pending_gain);
+            return true;
+        }
+        else
+        {
+            kill(v);
+        }
+        return false;
+    }
+
+    template <int NBR_VOICES>
+    inline void VoiceAlloc<NBR_VOICES>::kill(int v)
+    {
+        VoiceSlot& s = _slot_arr[v];
+        s._stage = VoiceSlot::Stage_IDLE;
+        s._env = 0;
+        s._env_step = 0;
+        s._env_left = 0;
+        s._pending_note = -1;
+    }
+
+    template <int NBR_VOICES>
+    inline void VoiceAlloc<NBR_VOICES>::kill_all()
+    {
+        for (int i = 0; i < NBR_VOICES; ++i)
+        {
+            kill(i);
+        }
+    }
+
+    /*------------------------------- stealing ------------------------------*/
+    /* free voice first, then the quietest releasing voice, then the
+       oldest one. Voices already fading for a pending note are only
+       taken when every voice is: the oldest of them. */
+    template <int NBR_VOICES>
+    inline int VoiceAlloc<NBR_VOICES>::find_voice_to_steal() const
+    {
+        int quietest = -1;
+        int oldest = -1;
+        for (int i = 0; i < NBR_VOICES; ++i)
+        {
+            const VoiceSlot& s = _slot_arr[i];
+            if (!s.is_active())
+            {
+                return i;
+            }
+            if (s._pending_note >= 0)
+            {
+                continue;
+            }
+            if (s._stage == VoiceSlot::Stage_RELEASE
+                && (quietest < 0 || s._env < _slot_arr[quietest]._env))
+            {
+                quietest = i;
+            }
+            if (oldest < 0 || is_older(s, _slot_arr[oldest]))
+            {
+                oldest = i;
+            }
+        }
+        if (quietest >= 0)
+        {
+            return quietest;
+        }
+        if (oldest >= 0)
+        {
+            return oldest;
+        }
+
+        int v = 0;
+        for (int i = 1; i < NBR_VOICES; ++i)
+        {
+            if (is_older(_slot_arr[i], _slot_arr[v]))
+            {
+                v = i;
+            }
+        }
+        return v;
+    }
+
+    template <int NBR_VOICES>
+    inline bool VoiceAlloc<NBR_VOICES>::is_any_active() const
+    {
+        for (int i = 0; i < NBR_VOICES; ++i)
+        {
+            if (_slot_arr[i].is_active())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <int NBR_VOICES>
+    inline VoiceSlot& VoiceAlloc<NBR_VOICES>::use_slot(int v)
+    {
+        assert(v >= 0 && v < NBR_VOICES);
+        return _slot_arr[v];
+    }
+
+    template <int NBR_VOICES>
+    inline const VoiceSlot& VoiceAlloc<NBR_VOICES>::use_slot(int v) const
+    {
+        assert(v >= 0 && v < NBR_VOICES);
+        return _slot_arr[v];
+    }
+
+    /*------------------------------- helpers -------------------------------*/
+    template <int NBR_VOICES>
+    inline void VoiceAlloc<NBR_VOICES>::start(int v, int note, float gain)
+    {
+        VoiceSlot& s = _slot_arr[v];
+        s._note = note;
+        s._gain = gain;
+        s._stamp = ++_counter;
+        s._pending_note = -1;
+        s._env = 0;
+        begin_ramp(s, VoiceSlot::Stage_ATTACK, 1, _attack_len);
+    }
+
+    template <int NBR_VOICES>
+    inline void VoiceAlloc<NBR_VOICES>::begin_ramp(VoiceSlot& s, VoiceSlot::Stage stage, float target, int len)
+    {
+        s._stage = stage;
+        s._env_step = (target - s._env) / static_cast<float>(len);
+        s._env_left = len;
+    }
+
+    /* the counter wraps around */
+    template <int NBR_VOICES>
+    inline bool VoiceAlloc<NBR_VOICES>::is_older(const VoiceSlot& a, const VoiceSlot& b)
+    {
+        return static_cast<Int32>(a._stamp - b._stamp) < 0;
+    }
+
+} // namespace rspl
+#endif // RSPL_VOICEALLOC_H
@@ -0,0 +1,762 @@
+/******************************************************************************
+    rspl_quality_test.cpp - Aliasing / SNR regression test for ResamplerFlt
+    No JUCE/HISE dependency. Renders the saw table through ResamplerFlt
+    at a stepped pitch sweep, one stationary segment per pitch, and
+    measures each segment with an in-tree FFT:
+
+        snr_db      harmonic energy over everything else, full band
+        spur_dbc    strongest non-harmonic bin relative to the strongest
+                    harmonic, i.e. the worst alias
+
+    Bins within HARM_HALF_WIDTH of a harmonic of the fundamental (DC
+    included) count as signal. A 7-term Blackman-Harris window keeps the
+    leakage far below the resampler noise floor.
+
+    The figures are compared with the reference file given on the command
+    line. A segment fails when its SNR drops by more than SNR_TOL_DB or
+    its worst spur rises by more than SPUR_TOL_DB. Improvements pass;
+    rerun with --update to store them.
+
+    The second part checks the fast paths against interpolate_block():
+    the shared 2x bus (interpolate_block_add_2x() + MixBusFlt) and the
+    per-sample frame path (interpolate_sample_add_2x()) must match it
+    within EQUIV_TOL across pitch changes that cross mip-map levels and
+    the oversampled / normal boundary.
+
+    The last part holds behaviour checks: a frame morph requested right
+    after the table is wired must play the linear mix of its two frames,
+    a one-voice UnisonFlt must
+    play what ResamplerFlt plays, at the centre pan gain, each voice of a
+    wider stack must play what a ResamplerFlt at its detuned pitch plays,
+    at its own pan gains, and a 2x
+    processor must get a real 2x stream from a negative-pitch voice,
+    whether it sits on the voice or on the bus.
+
+    Downsampler2FltN must match Downsampler2Flt on every lane, on the SSE
+    path (4 and 8 lanes) and the portable one (2 and 3), within
+    DWNSPL_TOL. The default build is bit-exact; the tolerance is for
+    builds where the compiler contracts one side into FMAs.
+
+        g++ -O2 -I. tests/rspl_quality_test.cpp rspl_big_arrays.cpp -o rspl_quality_test
+        ./rspl_quality_test tests/rspl_quality_ref.csv [--update]
+
+    Exit code 0 when everything passes.
+******************************************************************************/
+
+#include "rspl_framestore.h"
+#include "rspl_resamplerflt.h"
+#include "rspl_mixbus.h"
+#include "rspl_unison.h"
+
+#include <vector>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+
+    const long   BASE_CYCLE_LEN = 2048;
+    const int    NBR_LEVELS = 12;
+    const int    FFT_LEN_L2 = 17;
+    const long   FFT_LEN = 1L << FFT_LEN_L2;
+    const long   SETTLE_LEN = 4096;         // crossfade and filter settling
+    const long   BLOCK_LEN = 64;
+    const long   HARM_HALF_WIDTH = 9;       // window main lobe is +/-7 bins
+    const double SNR_TOL_DB = 0.5;
+    const double SPUR_TOL_DB = 1.0;
+    const float  EQUIV_TOL = 1e-5f;
+    const float  DWNSPL_TOL = 1e-6f;
+
+    /* -1 .. 9 octaves in half-octave steps: the normal path, every level
+       change on the oversampled path, up to a fundamental above fs / 4.
+       The semitone offset keeps the period away from a whole number of
+       samples; otherwise the aliases fold exactly onto the harmonics and
+       the measure cannot see them. */
+    const int    NBR_PITCHES = 21;
+    const double PITCH_OFS = 1.0 / 12;
+    double       pitch_oct_of(int idx) { return -1.0 + 0.5 * idx + PITCH_OFS; }
+
+    long to_pitch(double pitch_oct)
+    {
+        return static_cast<long>(floor(pitch_oct * (1L << rspl::ResamplerFlt::NBR_BITS_PER_OCT) + 0.5));
+    }
+
+    /* same saw as Griffin_WT::generateWavetable() */
+    void build_table(rspl::FrameStore& store, rspl::MipMapFlt& mip_map)
+    {
+        std::vector<float> raw(BASE_CYCLE_LEN);
+        const double saw_step = 2.0 / (static_cast<double>(BASE_CYCLE_LEN) - 1.0);
+        for (long s = 0; s < BASE_CYCLE_LEN; ++s)
+        {
+            raw[s] = static_cast<float>(0.8 * (-1.0 + saw_step * s));
+        }
+        store.build(&raw[0], 1, BASE_CYCLE_LEN, BASE_CYCLE_LEN / 2);
+
+        mip_map.init_sample(
+            store.get_table_len(),
+            rspl::InterpPack::get_len_pre(),
+            rspl::InterpPack::get_len_post(),
+            NBR_LEVELS,
+            rspl::MIP_MAP_FIR_COEF_ARR,
+            rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
+        mip_map.fill_sample(store.get_table(), store.get_table_len());
+    }
+
+    /*--------------------------------- FFT ---------------------------------*/
+    /* in-place iterative radix-2, double precision */
+    void fft(std::vector<std::complex<double> >& x)
+    {
+        const long n = static_cast<long>(x.size());
+        for (long i = 1, j = 0; i < n; ++i)
+        {
+            long bit = n >> 1;
+            for (; (j & bit) != 0; bit >>= 1)
+            {
+                j ^= bit;
+            }
+            j ^= bit;
+            if (i < j)
+            {
+                std::swap(x[i], x[j]);
+            }
+        }
+        for (long len = 2; len <= n; len <<= 1)
+        {
+            const double ang = -2 * rspl::PI / len;
+            const std::complex<double> w_len(cos(ang), sin(ang));
+            for (long i = 0; i < n; i += len)
+            {
+                std::complex<double> w(1, 0);
+                for (long k = 0; k < len / 2; ++k)
+                {
+                    const std::complex<double> u = x[i + k];
+                    const std::complex<double> v = x[i + k + len / 2] * w;
+                    x[i + k] = u + v;
+                    x[i + k + len / 2] = u - v;
+                    w *= w_len;
+                }
+            }
+        }
+    }
+
+    /* 7-term Blackman-Harris, about -180 dB sidelobes */
+    double window(long i, long n)
+    {
+        static const double coef_arr[7] =
+        {
+            0.27105140069342, -0.43329793923448, 0.21812299954311, -0.06592544638803,
+            0.01081174209837, -0.00077658482522, 0.00001388721735
+        };
+        const double ph = 2 * rspl::PI * i / n;
+        double w = 0;
+        for (int k = 0; k < 7; ++k)
+        {
+            w += coef_arr[k] * cos(k * ph);
+        }
+        return w;
+    }
+
+    class Measure
+    {
+    public:
+        double _snr_db;
+        double _spur_dbc;
+    };
+
+    Measure analyse(const std::vector<float>& sig, double f0)
+    {
+        std::vector<std::complex<double> > x(FFT_LEN);
+        for (long i = 0; i < FFT_LEN; ++i)
+        {
+            x[i] = sig[i] * window(i, FFT_LEN);
+        }
+        fft(x);
+
+        const long nbr_bins = FFT_LEN / 2;
+        std::vector<bool> harm_flag(nbr_bins + 1, false);
+        for (double f = 0; f <= 0.5; f += f0)
+        {
+            const long c = static_cast<long>(floor(f * FFT_LEN + 0.5));
+            const long b = std::max(0L, c - HARM_HALF_WIDTH);
+            const long e = std::min(nbr_bins, c + HARM_HALF_WIDTH);
+            for (long k = b; k <= e; ++k)
+            {
+                harm_flag[k] = true;
+            }
+        }
+
+        double sig_pow = 0;
+        double noise_pow = 1e-300;
+        double harm_peak = 1e-300;
+        double spur_peak = 1e-300;
+        for (long k = 0; k <= nbr_bins; ++k)
+        {
+            const double p = std::norm(x[k]);
+            if (harm_flag[k])
+            {
+                sig_pow += p;
+                harm_peak = std::max(harm_peak, p);
+            }
+            else
+            {
+                noise_pow += p;
+                spur_peak = std::max(spur_peak, p);
+            }
+        }
+
+        Measure m;
+        m._snr_db = 10 * log10(sig_pow / noise_pow);
+        m._spur_dbc = 10 * log10(spur_peak / harm_peak);
+        return m;
+    }
+
+    /*------------------------------ quality --------------------------------*/
+    void render_segment(std::vector<float>& sig, const rspl::MipMapFlt& mip_map, const rspl::InterpPack& pack, long pitch)
+    {
+        rspl::ResamplerFlt rspl;
+        rspl.set_sample(mip_map);
+        rspl.set_interp(pack);
+        rspl.set_pitch(pitch);
+        std::vector<float> settle(SETTLE_LEN);
+        for (long pos = 0; pos < SETTLE_LEN; pos += BLOCK_LEN)
+        {
+            rspl.interpolate_block(&settle[pos], BLOCK_LEN);
+        }
+        sig.resize(FFT_LEN);
+        for (long pos = 0; pos < FFT_LEN; pos += BLOCK_LEN)
+        {
+            rspl.interpolate_block(&sig[pos], BLOCK_LEN);
+        }
+    }
+
+    bool read_ref(const char* path_0, std::vector<Measure>& ref_arr)
+    {
+        FILE* f_ptr = fopen(path_0, "r");
+        if (f_ptr == 0)
+        {
+            return false;
+        }
+        ref_arr.assign(NBR_PITCHES, Measure());
+        int nbr_read = 0;
+        char line[256];
+        while (fgets(line, sizeof(line), f_ptr) != 0)
+        {
+            double pitch_oct;
+            Measure m;
+            if (line[0] != '#' && sscanf(line, "%lf,%lf,%lf", &pitch_oct, &m._snr_db, &m._spur_dbc) == 3)
+            {
+                const int idx = static_cast<int>(floor((pitch_oct + 1.0 - PITCH_OFS) * 2 + 0.5));
+                if (idx >= 0 && idx < NBR_PITCHES)
+                {
+                    ref_arr[idx] = m;
+                    ++nbr_read;
+                }
+            }
+        }
+        fclose(f_ptr);
+        return (nbr_read == NBR_PITCHES);
+    }
+
+    bool write_ref(const char* path_0, const std::vector<Measure>& res_arr)
+    {
+        FILE* f_ptr = fopen(path_0, "w");
+        if (f_ptr == 0)
+        {
+            return false;
+        }
+        fprintf(f_ptr, "# pitch_oct,snr_db,spur_dbc - written by rspl_quality_test --update\n");
+        for (int i = 0; i < NBR_PITCHES; ++i)
+        {
+            fprintf(f_ptr, "%.2f,%.2f,%.2f\n", pitch_oct_of(i), res_arr[i]._snr_db, res_arr[i]._spur_dbc);
+        }
+        fclose(f_ptr);
+        return true;
+    }
+
+    int test_quality(const rspl::MipMapFlt& mip_map, const rspl::InterpPack& pack, const char* ref_path_0, bool update_flag)
+    {
+        std::vector<Measure> res_arr(NBR_PITCHES);
+        std::vector<float> sig;
+        for (int i = 0; i < NBR_PITCHES; ++i)
+        {
+            const double pitch_oct = pitch_oct_of(i);
+            render_segment(sig, mip_map, pack, to_pitch(pitch_oct));
+            res_arr[i] = analyse(sig, pow(2.0, pitch_oct) / BASE_CYCLE_LEN);
+        }
+
+        if (update_flag)
+        {
+            if (!write_ref(ref_path_0, res_arr))
+            {
+                printf("cannot write %s\n", ref_path_0);
+                return 1;
+            }
+            printf("reference written to %s\n", ref_path_0);
+            return 0;
+        }
+
+        std::vector<Measure> ref_arr;
+        if (!read_ref(ref_path_0, ref_arr))
+        {
+            printf("cannot read %s, run with --update to create it\n", ref_path_0);
+            return 1;
+        }
+
+        int nbr_fail = 0;
+        printf("pitch_oct,snr_db,ref_snr_db,spur_dbc,ref_spur_dbc,status\n");
+        for (int i = 0; i < NBR_PITCHES; ++i)
+        {
+            const Measure& res = res_arr[i];
+            const Measure& ref = ref_arr[i];
+            const bool ok_flag =
+                   res._snr_db >= ref._snr_db - SNR_TOL_DB
+                && res._spur_dbc <= ref._spur_dbc + SPUR_TOL_DB;
+            printf("%.2f,%.2f,%.2f,%.2f,%.2f,%s\n", pitch_oct_of(i),
+                res._snr_db, ref._snr_db, res._spur_dbc, ref._spur_dbc, ok_flag ? "ok" : "FAIL");
+            if (!ok_flag)
+            {
+                ++nbr_fail;
+            }
+        }
+        return nbr_fail;
+    }
+
+    /*---------------------------- equivalence ------------------------------*/
+    int test_fast_paths(const rspl::MipMapFlt& mip_map, const rspl::InterpPack& pack)
+    {
+        /* crosses levels, the normal path and back; changes land both on
+           and between block boundaries */
+        const double pitch_arr[] = { -1.3, -0.2, 0.4, 2.7, 2.9, 6.1, 0.0, -0.6, 8.4, 3.3 };
+        const int    nbr_changes = sizeof(pitch_arr) / sizeof(pitch_arr[0]);
+        const long   seg_len = 1000;
+        const long   total_len = seg_len * nbr_changes;
+
+        rspl::ResamplerFlt rspl_ref;
+        rspl::ResamplerFlt rspl_bus;
+        rspl::ResamplerFlt rspl_frm;
+        rspl::ResamplerFlt* rspl_arr[3] = { &rspl_ref, &rspl_bus, &rspl_frm };
+        for (rspl::ResamplerFlt* r_ptr : rspl_arr)
+        {
+            r_ptr->set_sample(mip_map);
+            r_ptr->set_interp(pack);
+        }
+        rspl::MixBusFlt bus;
+        rspl::MixBusFlt bus_frm;
+        bus.set_max_block_len(BLOCK_LEN);
+
+        std::vector<float> out_ref(total_len);
+        std::vector<float> out_bus(total_len);
+        std::vector<float> out_frm(total_len);
+        long pos = 0;
+        while (pos < total_len)
+        {
+            if (pos % seg_len == 0)
+            {
+                const long pitch = to_pitch(pitch_arr[pos / seg_len]);
+                for (rspl::ResamplerFlt* r_ptr : rspl_arr)
+                {
+                    r_ptr->set_pitch(pitch);
+                }
+            }
+            const long len = std::min(BLOCK_LEN, seg_len - pos % seg_len);
+
+            rspl_ref.interpolate_block(&out_ref[pos], len);
+
+            float* bus_ptr = bus.begin_block(len);
+            rspl_bus.interpolate_block_add_2x(bus_ptr, len, 1.0f, 0.0f);
+            bus.end_block(&out_bus[pos], len);
+
+            for (long i = 0; i < len; ++i)
+            {
+                float* frm_ptr = bus_frm.begin_frame();
+                rspl_frm.interpolate_sample_add_2x(frm_ptr, 1.0f);
+                out_frm[pos + i] = bus_frm.end_frame();
+            }
+
+            pos += len;
+        }
+
+        float err_bus = 0;
+        float err_frm = 0;
+        for (long i = 0; i < total_len; ++i)
+        {
+            err_bus = std::max(err_bus, std::fabs(out_bus[i] - out_ref[i]));
+            err_frm = std::max(err_frm, std::fabs(out_frm[i] - out_ref[i]));
+        }
+        printf("path,max_abs_err,tolerance,status\n");
+        printf("bus_block,%g,%g,%s\n", err_bus, EQUIV_TOL, (err_bus <= EQUIV_TOL) ? "ok" : "FAIL");
+        printf("bus_frame,%g,%g,%s\n", err_frm, EQUIV_TOL, (err_frm <= EQUIV_TOL) ? "ok" : "FAIL");
+
+        return ((err_bus <= EQUIV_TOL) ? 0 : 1) + ((err_frm <= EQUIV_TOL) ? 0 : 1);
+    }
+
+    /*------------------------------ behaviour ------------------------------*/
+    /* saw then sine, one cycle each, on a short mip map */
+    void build_table_2_frames(rspl::FrameStore& store, rspl::MipMapFlt& mip_map)
+    {
+        std::vector<float> raw(2 * BASE_CYCLE_LEN);
+        for (long s = 0; s < BASE_CYCLE_LEN; ++s)
+        {
+            const double ph = static_cast<double>(s) / BASE_CYCLE_LEN;
+            raw[s] = static_cast<float>(0.8 * (2 * ph - 1));
+            raw[BASE_CYCLE_LEN + s] = static_cast<float>(0.8 * sin(2 * rspl::PI * ph));
+        }
+        store.build(&raw[0], 2, BASE_CYCLE_LEN, BASE_CYCLE_LEN / 2);
+
+        mip_map.init_sample(
+            store.get_table_len(),
+            rspl::InterpPack::get_len_pre(),
+            rspl::InterpPack::get_len_post(),
+            4,
+            rspl::MIP_MAP_FIR_COEF_ARR,
+            rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
+        mip_map.fill_sample(store.get_table(), store.get_table_len());
+    }
+
+    void render_frame(std::vector<float>& out, const rspl::FrameStore& store, const rspl::MipMapFlt& mip_map,
+        const rspl::InterpPack& pack, float frame_pos)
+    {
+        rspl::ResamplerFlt rspl;
+        rspl.set_sample(mip_map);
+        rspl.set_interp(pack);
+        rspl.set_frame_layout(store.get_frame_stride(), store.get_nbr_frames(), store.get_frame_map());
+        rspl.set_pitch(0);
+        rspl.set_frame_pos(frame_pos);
+        out.resize(4 * BLOCK_LEN);
+        for (long pos = 0; pos < static_cast<long>(out.size()); pos += BLOCK_LEN)
+        {
+            rspl.interpolate_block(&out[pos], BLOCK_LEN);
+        }
+    }
+
+    /* the layout is set after the sample, as every caller does. A frame
+       position between two frames must play the linear mix of both, once
+       the morph ramp of the first block is over. */
+    int test_frame_layout(const rspl::InterpPack& pack)
+    {
+        rspl::FrameStore store;
+        rspl::MipMapFlt  mip_map;
+        build_table_2_frames(store, mip_map);
+
+        std::vector<float> out_0;
+        std::vector<float> out_1;
+        render_frame(out_0, store, mip_map, pack, 0.0f);
+        render_frame(out_1, store, mip_map, pack, 1.0f);
+
+        printf("check,value,status\n");
+        const float morph_arr[] = { 0.25f, 0.5f };
+        int nbr_fail = 0;
+        for (int m = 0; m < 2; ++m)
+        {
+            const float morph = morph_arr[m];
+            std::vector<float> out_m;
+            render_frame(out_m, store, mip_map, pack, morph);
+            float err = 0;
+            for (size_t i = BLOCK_LEN; i < out_m.size(); ++i)
+            {
+                const float ref = out_0[i] + (out_1[i] - out_0[i]) * morph;
+                err = std::max(err, std::fabs(out_m[i] - ref));
+            }
+            const bool ok_flag = (err <= EQUIV_TOL);
+            printf("morph_after_layout_%g,%g,%s\n", morph, err, ok_flag ? "ok" : "FAIL");
+            nbr_fail += ok_flag ? 0 : 1;
+        }
+
+        return nbr_fail;
+    }
+
+    /* one voice, no detune, no spread, through the same pitch changes as
+       test_fast_paths(): both channels carry the resampler output times
+       cos(pi / 4) */
+    int test_unison(const rspl::MipMapFlt& mip_map, const rspl::InterpPack& pack)
+    {
+        const double pitch_arr[] = { -1.3, -0.2, 0.4, 2.7, 6.1, 0.0, -0.6, 3.3 };
+        const int    nbr_changes = sizeof(pitch_arr) / sizeof(pitch_arr[0]);
+        const long   seg_len = 1000;
+
+        rspl::ResamplerFlt rspl;
+        rspl::UnisonFlt    unison;
+        rspl.set_sample(mip_map);
+        rspl.set_interp(pack);
+        unison.set_sample(mip_map);
+        unison.set_interp(pack);
+        unison.set_nbr_voices(1);
+
+        const float pan = static_cast<float>(cos(rspl::PI * 0.25));
+        std::vector<float> out_ref(BLOCK_LEN);
+        std::vector<float> out_l(BLOCK_LEN);
+        std::vector<float> out_r(BLOCK_LEN);
+        float err = 0;
+        for (long pos = 0; pos < seg_len * nbr_changes; )
+        {
+            if (pos % seg_len == 0)
+            {
+                const long pitch = to_pitch(pitch_arr[pos / seg_len]);
+                rspl.set_pitch(pitch);
+                unison.set_pitch(pitch);
+            }
+            const long len = std::min(BLOCK_LEN, seg_len - pos % seg_len);
+            rspl.interpolate_block(&out_ref[0], len);
+            unison.interpolate_block(&out_l[0], &out_r[0], len);
+            for (long i = 0; i < len; ++i)
+            {
+                const float ref = out_ref[i] * pan;
+                err = std::max(err, std::max(std::fabs(out_l[i] - ref), std::fabs(out_r[i] - ref)));
+            }
+            pos += len;
+        }
+
+        const bool ok_flag = (err <= EQUIV_TOL);
+        printf("unison_1_voice,%g,%s\n", err, ok_flag ? "ok" : "FAIL");
+
+        return ok_flag ? 0 : 1;
+    }
+
+    /* K voices: lane k must sound like a ResamplerFlt at that lane's pitch
+       and start phase, at the lane's pan gains. The pitches are kept on
+       level 0 of the oversampled path so both sides read the same table,
+       and the detune is a multiple of 4 units so each lane pitch is exact.
+       5 voices cover one 4-lane group and a leftover lane. */
+    int test_unison_stack(const rspl::MipMapFlt& mip_map, const rspl::InterpPack& pack)
+    {
+        const int    nbr_voices = 5;
+        const long   detune = to_pitch(0.5) & ~3L;
+        const long   pitch = to_pitch(0.6);
+        const long   top_pitch = pitch + detune / 2;
+        const long   len_total = 4000;
+        const double golden = 0.61803398874989484820;
+
+        rspl::UnisonFlt unison;
+        unison.set_sample(mip_map);
+        unison.set_interp(pack);
+        unison.set_nbr_voices(nbr_voices);
+        unison.set_detune(detune);
+        unison.set_spread(1);
+        unison.set_pitch(pitch);
+
+        std::vector<rspl::ResamplerFlt> lane_arr(nbr_voices);
+        float pan_l_arr[nbr_voices];
+        float pan_r_arr[nbr_voices];
+        const double norm = 1.0 / sqrt(static_cast<double>(nbr_voices));
+        for (int k = 0; k < nbr_voices; ++k)
+        {
+            const double pos = 2.0 * k / (nbr_voices - 1) - 1.0;
+            const double pan = ((k & 1) != 0) ? -pos : pos;
+            const double angle = (pan + 1.0) * (rspl::PI * 0.25);
+            pan_l_arr[k] = static_cast<float>(norm * cos(angle));
+            pan_r_arr[k] = static_cast<float>(norm * sin(angle));
+
+            const double frac = k * golden - floor(k * golden);
+            rspl::ResamplerFlt& r = lane_arr[k];
+            r.set_sample(mip_map);
+            r.set_interp(pack);
+            r.set_pitch(top_pitch + (k - (nbr_voices - 1)) * (detune / (nbr_voices - 1)));
+            r.set_playback_pos(static_cast<rspl::Int64>(frac * BASE_CYCLE_LEN * 4294967296.0));
+        }
+
+        std::vector<float> out_ref(BLOCK_LEN);
+        std::vector<float> out_l(BLOCK_LEN);
+        std::vector<float> out_r(BLOCK_LEN);
+        std::vector<float> ref_l(BLOCK_LEN);
+        std::vector<float> ref_r(BLOCK_LEN);
+        float err = 0;
+        for (long pos = 0; pos < len_total; pos += BLOCK_LEN)
+        {
+            const long len = std::min(BLOCK_LEN, len_total - pos);
+            std::fill(ref_l.begin(), ref_l.end(), 0.0f);
+            std::fill(ref_r.begin(), ref_r.end(), 0.0f);
+            for (int k = 0; k < nbr_voices; ++k)
+            {
+                lane_arr[k].interpolate_block(&out_ref[0], len);
+                for (long i = 0; i < len; ++i)
+                {
+                    ref_l[i] += out_ref[i] * pan_l_arr[k];
+                    ref_r[i] += out_ref[i] * pan_r_arr[k];
+                }
+            }
+            unison.interpolate_block(&out_l[0], &out_r[0], len);
+            for (long i = 0; i < len; ++i)
+            {
+                err = std::max(err, std::max(std::fabs(out_l[i] - ref_l[i]), std::fabs(out_r[i] - ref_r[i])));
+            }
+        }
+
+        const bool ok_flag = (err <= EQUIV_TOL);
+        printf("unison_%d_voices,%g,%s\n", nbr_voices, err, ok_flag ? "ok" : "FAIL");
+
+        return ok_flag ? 0 : 1;
+    }
+
+    /* passes the signal through, measuring the odd samples against the
+       even ones: a zero-stuffed stream has no energy on the odd ones */
+    class Probe2x : public rspl::Proc2xInterface
+    {
+    public:
+        Probe2x() : _even_pow(0), _odd_pow(0) {}
+        virtual void process_block_2x(float data_ptr[], long nbr_spl)
+        {
+            for (long i = 0; i + 1 < nbr_spl; i += 2)
+            {
+                _even_pow += static_cast<double>(data_ptr[i]) * data_ptr[i];
+                _odd_pow += static_cast<double>(data_ptr[i + 1]) * data_ptr[i + 1];
+            }
+        }
+        double get_ratio() const { return (_even_pow > 0) ? _odd_pow / _even_pow : 0; }
+    private:
+        double _even_pow;
+        double _odd_pow;
+    };
+
+    int test_proc_2x(const rspl::MipMapFlt& mip_map, const rspl::InterpPack& pack)
+    {
+        const long pitch = to_pitch(-1.5);
+        const long nbr_blocks = 32;
+
+        /* processor on the voice */
+        Probe2x probe_voice;
+        rspl::ResamplerFlt rspl_voice;
+        rspl_voice.set_sample(mip_map);
+        rspl_voice.set_interp(pack);
+        rspl_voice.set_proc_2x(&probe_voice);
+        rspl_voice.set_pitch(pitch);
+        std::vector<float> out(BLOCK_LEN);
+        for (long b = 0; b < nbr_blocks; ++b)
+        {
+            rspl_voice.interpolate_block(&out[0], BLOCK_LEN);
+        }
+
+        /* processor on the bus, the voice switched as the bus asks */
+        Probe2x probe_bus;
+        rspl::MixBusFlt bus;
+        bus.set_max_block_len(BLOCK_LEN);
+        bus.set_proc_2x(&probe_bus);
+        rspl::ResamplerFlt rspl_bus;
+        rspl_bus.set_sample(mip_map);
+        rspl_bus.set_interp(pack);
+        rspl_bus.set_force_ovrspl(bus.needs_ovrspl());
+        rspl_bus.set_pitch(pitch);
+        for (long b = 0; b < nbr_blocks; ++b)
+        {
+            float* bus_ptr = bus.begin_block(BLOCK_LEN);
+            rspl_bus.interpolate_block_add_2x(bus_ptr, BLOCK_LEN, 1.0f, 0.0f);
+            bus.end_block(&out[0], BLOCK_LEN);
+        }
+
+        /* a real 2x stream of a low note has about as much energy on odd
+           samples as on even ones */
+        const double ratio_voice = probe_voice.get_ratio();
+        const double ratio_bus = probe_bus.get_ratio();
+        const bool ok_voice = (ratio_voice > 0.5);
+        const bool ok_bus = (ratio_bus > 0.5);
+        printf("proc_2x_voice_neg_pitch,%g,%s\n", ratio_voice, ok_voice ? "ok" : "FAIL");
+        printf("proc_2x_bus_neg_pitch,%g,%s\n", ratio_bus, ok_bus ? "ok" : "FAIL");
+
+        return (ok_voice ? 0 : 1) + (ok_bus ? 0 : 1);
+    }
+
+    /* each lane gets its own noise, all lanes share one sequence of block
+       lengths; downsample_block() and phase_block() alternate so the
+       state carries over between them */
+    template <int N>
+    int test_dwnspl_lanes()
+    {
+        const long max_len = 100;
+        const long len_arr[] = { 1, 7, 64, 100, 33, 64, 2, 90 };
+
+        rspl::Downsampler2FltN<N> dwnspl_n;
+        dwnspl_n.set_coefs(rspl::DOWNSAMPLER_COEF_ARR);
+        rspl::Downsampler2Flt dwnspl_arr[N];
+        for (int lane = 0; lane < N; ++lane)
+        {
+            dwnspl_arr[lane].set_coefs(rspl::DOWNSAMPLER_COEF_ARR);
+        }
+
+        std::vector<float> src_n(max_len * 2 * N);
+        std::vector<float> dst_n(max_len * N);
+        std::vector<float> src(max_len * 2);
+        std::vector<float> dst(max_len);
+        unsigned int rnd = 0x2545F491U;
+        float err = 0;
+        int  blk = 0;
+        for (long len : len_arr)
+        {
+            const bool phase_flag = ((blk & 1) != 0);
+            const long src_len = phase_flag ? len : len * 2;
+            for (long i = 0; i < src_len * N; ++i)
+            {
+                rnd = rnd * 1664525U + 1013904223U;
+                src_n[i] = static_cast<float>(rnd >> 8) * (2.0f / 16777216.0f) - 1.0f;
+            }
+            if (phase_flag)
+            {
+                dwnspl_n.phase_block(&dst_n[0], &src_n[0], len);
+            }
+            else
+            {
+                dwnspl_n.downsample_block(&dst_n[0], &src_n[0], len);
+            }
+
+            for (int lane = 0; lane < N; ++lane)
+            {
+                for (long i = 0; i < src_len; ++i)
+                {
+                    src[i] = src_n[i * N + lane];
+                }
+                if (phase_flag)
+                {
+                    dwnspl_arr[lane].phase_block(&dst[0], &src[0], len);
+                }
+                else
+                {
+                    dwnspl_arr[lane].downsample_block(&dst[0], &src[0], len);
+                }
+                for (long i = 0; i < len; ++i)
+                {
+                    err = std::max(err, std::fabs(dst[i] - dst_n[i * N + lane]));
+                }
+            }
+            ++blk;
+        }
+
+        const bool ok_flag = (err <= DWNSPL_TOL);
+        printf("dwnspl_lanes_%d,%g,%s\n", N, err, ok_flag ? "ok" : "FAIL");
+        return ok_flag ? 0 : 1;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("usage: %s reference.csv [--update]\n", argv[0]);
+        return 2;
+    }
+    const char* ref_path_0 = argv[1];
+    const bool update_flag = (argc > 2 && strcmp(argv[2], "--update") == 0);
+
+    rspl::FrameStore store;
+    rspl::MipMapFlt  mip_map;
+    rspl::InterpPack pack;
+    build_table(store, mip_map);
+
+    int nbr_fail = test_quality(mip_map, pack, ref_path_0, update_flag);
+    if (!update_flag)
+    {
+        nbr_fail += test_fast_paths(mip_map, pack);
+        nbr_fail += test_frame_layout(pack);
+        nbr_fail += test_unison(mip_map, pack);
+        nbr_fail += test_unison_stack(mip_map, pack);
+        nbr_fail += test_proc_2x(mip_map, pack);
+        nbr_fail += test_dwnspl_lanes<2>();
+        nbr_fail += test_dwnspl_lanes<3>();
+        nbr_fail += test_dwnspl_lanes<4>();
+        nbr_fail += test_dwnspl_lanes<8>();
+    }
+
+    printf("%s\n", (nbr_fail == 0) ? "PASSED" : "FAILED");
+    return (nbr_fail == 0) ? 0 : 1;
+}
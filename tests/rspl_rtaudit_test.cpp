@@ -0,0 +1,134 @@
+/******************************************************************************
+    rspl_rtaudit_test.cpp - Checks for the real-time safety audit
+    Built with RSPL_RT_AUDIT and its own copy of the hooks, so it runs
+    whatever the RSPL_RT_AUDIT option of the library is:
+
+        allocations and frees inside an RtAuditScope are counted, plain
+        and aligned; the same calls outside a scope are not
+        report() returns the violations and resets the counters
+        on Linux, a mutex locked inside a scope is counted, and threads
+        entering the lock hook together for the first time all get the
+        real function
+
+        g++ -O2 -I. -DRSPL_RT_AUDIT tests/rspl_rtaudit_test.cpp rspl_rtaudit.cpp -o rspl_rtaudit_test -ldl -lpthread
+        ./rspl_rtaudit_test
+
+    Prints one line per check; exit code 0 when everything passes.
+******************************************************************************/
+
+#include "rspl_rtaudit.h"
+
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+namespace
+{
+
+    /* keeps the allocations observable */
+    void* volatile sink_ptr = 0;
+
+    int check(const char* name_0, long val, bool ok_flag)
+    {
+        printf("%s,%ld,%s\n", name_0, val, ok_flag ? "ok" : "FAIL");
+        return ok_flag ? 0 : 1;
+    }
+
+    int test_alloc()
+    {
+        int nbr_fail = 0;
+        rspl::RtAudit::report("reset", 0);
+
+        /* outside a scope: not the audio thread's business */
+        sink_ptr = ::operator new(64);
+        ::operator delete(sink_ptr);
+        const long nbr_outside = rspl::RtAudit::report("outside", 0);
+        nbr_fail += check("audit_outside_scope", nbr_outside, nbr_outside == 0);
+
+        {
+            rspl::RtAuditScope scope;
+            sink_ptr = ::operator new(64);
+            ::operator delete(sink_ptr);
+        }
+        const long nbr_alloc = rspl::RtAudit::get_nbr_alloc();
+        const long nbr_free = rspl::RtAudit::get_nbr_free();
+        const long nbr_viol = rspl::RtAudit::report("plain", 0);
+        nbr_fail += check("audit_alloc_in_scope", nbr_alloc,
+            nbr_alloc == 1 && nbr_free == 1 && nbr_viol == 2);
+        nbr_fail += check("audit_report_resets", rspl::RtAudit::get_nbr_alloc(),
+            rspl::RtAudit::get_nbr_alloc() == 0 && rspl::RtAudit::get_nbr_free() == 0);
+
+        {
+            rspl::RtAuditScope scope;
+            sink_ptr = ::operator new(256, std::align_val_t(64));
+            ::operator delete(sink_ptr, std::align_val_t(64));
+        }
+        const long nbr_alloc_aligned = rspl::RtAudit::get_nbr_alloc();
+        const long nbr_free_aligned = rspl::RtAudit::get_nbr_free();
+        rspl::RtAudit::report("aligned", 0);
+        nbr_fail += check("audit_aligned_in_scope", nbr_alloc_aligned,
+            nbr_alloc_aligned == 1 && nbr_free_aligned == 1);
+
+        return nbr_fail;
+    }
+
+#if defined (__linux__)
+    int test_lock()
+    {
+        int nbr_fail = 0;
+
+        /* threads entering the hook together, possibly while the real
+           function is still being resolved */
+        const int nbr_threads = 4;
+        std::mutex mtx;
+        long total = 0;
+        {
+            std::vector<std::thread> thread_arr;
+            for (int t = 0; t < nbr_threads; ++t)
+            {
+                thread_arr.emplace_back([&mtx, &total]()
+                {
+                    for (int i = 0; i < 1000; ++i)
+                    {
+                        std::lock_guard<std::mutex> lock(mtx);
+                        ++total;
+                    }
+                });
+            }
+            for (std::thread& th : thread_arr)
+            {
+                th.join();
+            }
+        }
+        nbr_fail += check("audit_lock_first_use", total, total == nbr_threads * 1000);
+        rspl::RtAudit::report("reset", 0);
+
+        {
+            rspl::RtAuditScope scope;
+            std::lock_guard<std::mutex> lock(mtx);
+            ++total;
+        }
+        const long nbr_lock = rspl::RtAudit::get_nbr_lock();
+        rspl::RtAudit::report("lock", 0);
+        nbr_fail += check("audit_lock_in_scope", nbr_lock, nbr_lock == 1);
+
+        return nbr_fail;
+    }
+#endif
+
+} // namespace
+
+int main()
+{
+    printf("check,value,status\n");
+    int nbr_fail = 0;
+    nbr_fail += test_alloc();
+#if defined (__linux__)
+    nbr_fail += test_lock();
+#endif
+
+    printf("%s\n", (nbr_fail == 0) ? "PASSED" : "FAILED");
+    return (nbr_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,597 @@
+/******************************************************************************
+    rspl_unit_test.cpp - Unit tests for the node's plain C++ parts
+    No JUCE/HISE dependency. Covers the pieces Griffin_WT is built from
+    that have no audio to measure:
+
+        SpscQueue       full queue, FIFO order across index wrap-around,
+                        one producer and one consumer thread
+        EventQueue      sorting, block splitting, sub-block coalescing
+                        up to the block end, carry-over into the next
+                        block
+        VoiceAlloc      free voices first, retrigger, steal order
+                        (quietest releasing, oldest, oldest pending),
+                        envelope stages and pending notes
+        ParamHandoff    newest change wins between slots and queued
+                        changes, also for a change carried over into a
+                        later block; full queue falls back to the slot
+        FrameStore      frame count, frame map and stored content for a
+                        table with duplicates; tolerance 0 merges exact
+                        copies only; identical frames share one slot
+
+        g++ -O2 -I. tests/rspl_unit_test.cpp -o rspl_unit_test -lpthread
+        ./rspl_unit_test
+
+    Prints one line per check; exit code 0 when everything passes.
+******************************************************************************/
+
+#include "rspl_eventqueue.h"
+#include "rspl_framestore.h"
+#include "rspl_paramhandoff.h"
+#include "rspl_spscqueue.h"
+#include "rspl_voicealloc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+    int check(const char* name_0, long val, bool ok_flag)
+    {
+        printf("%s,%ld,%s\n", name_0, val, ok_flag ? "ok" : "FAIL");
+        return ok_flag ? 0 : 1;
+    }
+
+    /*------------------------------ SpscQueue ------------------------------*/
+    int test_spsc_queue()
+    {
+        int nbr_fail = 0;
+
+        /* fills up, refuses one more, empties in order */
+        rspl::SpscQueue<int, 8> q;
+        int nbr_pushed = 0;
+        while (q.push(nbr_pushed))
+        {
+            ++nbr_pushed;
+        }
+        nbr_fail += check("spsc_full_after", nbr_pushed, nbr_pushed == 8);
+        int val = -1;
+        bool order_flag = true;
+        for (int i = 0; i < nbr_pushed; ++i)
+        {
+            order_flag &= (q.pop(val) && val == i);
+        }
+        nbr_fail += check("spsc_fifo", val, order_flag && q.empty() && !q.pop(val));
+
+        /* the read and write indexes run far past the capacity */
+        int next_in = 0;
+        int next_out = 0;
+        bool wrap_flag = true;
+        for (int round = 0; round < 1000; ++round)
+        {
+            const int nbr = 1 + round % 8;
+            for (int i = 0; i < nbr; ++i)
+            {
+                wrap_flag &= q.push(next_in++);
+            }
+            for (int i = 0; i < nbr; ++i)
+            {
+                wrap_flag &= (q.pop(val) && val == next_out++);
+            }
+        }
+        nbr_fail += check("spsc_wrap_around", next_out, wrap_flag && q.empty());
+
+        /* two threads, the consumer checks the sequence */
+        const int nbr_items = 200000;
+        rspl::SpscQueue<int, 64> tq;
+        std::thread producer([&tq, nbr_items]()
+        {
+            for (int i = 0; i < nbr_items; )
+            {
+                if (tq.push(i))
+                {
+                    ++i;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        int expected = 0;
+        bool thread_flag = true;
+        while (expected < nbr_items)
+        {
+            if (tq.pop(val))
+            {
+                thread_flag &= (val == expected);
+                ++expected;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        nbr_fail += check("spsc_threads", expected, thread_flag && tq.empty());
+
+        return nbr_fail;
+    }
+
+    /*------------------------------ EventQueue -----------------------------*/
+    class Trace
+    {
+    public:
+        class Item
+        {
+        public:
+            char    _kind;      // 'e' event applied, 'r' segment rendered
+            int     _a;         // event index or segment start
+            int     _b;         // segment length
+        };
+
+        void apply(const rspl::TimedEvent& e) { Item it = { 'e', e._index, 0 }; _item_arr.push_back(it); }
+        void render(int pos, int len)         { Item it = { 'r', pos, len };    _item_arr.push_back(it); }
+
+        bool equals(const char* spec_0) const
+        {
+            std::string s;
+            char buf[32];
+            for (const Item& it : _item_arr)
+            {
+                if (it._kind == 'e')
+                {
+                    snprintf(buf, sizeof(buf), "e%d ", it._a);
+                }
+                else
+                {
+                    snprintf(buf, sizeof(buf), "r%d+%d ", it._a, it._b);
+                }
+                s += buf;
+            }
+            if (s != spec_0)
+            {
+                printf("  got:      %s\n  expected: %s\n", s.c_str(), spec_0);
+            }
+            return (s == spec_0);
+        }
+
+        std::vector<Item> _item_arr;
+    };
+
+    rspl::TimedEvent make_event(int offset, int index)
+    {
+        rspl::TimedEvent e = { offset, rspl::TimedEvent::Type_NOTE_ON, index, 1.0f, 0 };
+        return e;
+    }
+
+    template <int CAP>
+    void run_block(rspl::EventQueue<CAP>& q, Trace& t, int nbr_spl, int min_sub_block)
+    {
+        q.process_block(nbr_spl, min_sub_block,
+            [&t](const rspl::TimedEvent& e) { t.apply(e); },
+            [&t](int pos, int len) { t.render(pos, len); });
+    }
+
+    int test_event_queue()
+    {
+        int nbr_fail = 0;
+
+        /* sorted on insertion, equal offsets keep their order, negative
+           offsets are due at once */
+        {
+            rspl::EventQueue<8> q;
+            q.push(make_event(40, 0));
+            q.push(make_event(10, 1));
+            q.push(make_event(40, 2));
+            q.push(make_event(-5, 3));
+            q.push(make_event(10, 4));
+            const int order_arr[] = { 3, 1, 4, 0, 2 };
+            bool ok_flag = (q.get_nbr_events() == 5);
+            for (int i = 0; ok_flag && i < 5; ++i)
+            {
+                ok_flag = (q.use_event(i)._index == order_arr[i]);
+            }
+            ok_flag &= (q.use_event(0)._offset == 0);
+            nbr_fail += check("evq_sorted_stable", q.get_nbr_events(), ok_flag);
+        }
+
+        /* a full queue refuses the event */
+        {
+            rspl::EventQueue<4> q;
+            int nbr = 0;
+            while (q.push(make_event(nbr, nbr)))
+            {
+                ++nbr;
+            }
+            nbr_fail += check("evq_full", nbr, nbr == 4);
+        }
+
+        /* splits at the offsets, applies each event before its segment */
+        {
+            rspl::EventQueue<8> q;
+            Trace t;
+            q.push(make_event(0, 0));
+            q.push(make_event(100, 1));
+            q.push(make_event(300, 2));
+            run_block(q, t, 512, 16);
+            nbr_fail += check("evq_split", q.get_nbr_events(),
+                t.equals("e0 r0+100 e1 r100+200 e2 r300+212 ") && q.get_nbr_events() == 0);
+        }
+
+        /* events less than min_sub_block past the split point join it */
+        {
+            rspl::EventQueue<8> q;
+            Trace t;
+            q.push(make_event(100, 0));
+            q.push(make_event(105, 1));
+            q.push(make_event(115, 2));
+            q.push(make_event(116, 3));
+            run_block(q, t, 256, 16);
+            nbr_fail += check("evq_coalesce", q.get_nbr_events(),
+                t.equals("r0+100 e0 e1 e2 r100+16 e3 r116+140 "));
+        }
+
+        /* events past the block wait, with their offset moved */
+        {
+            rspl::EventQueue<8> q;
+            Trace t;
+            q.push(make_event(50, 0));
+            q.push(make_event(700, 1));
+            run_block(q, t, 512, 16);
+            const bool kept_flag = (q.get_nbr_events() == 1 && q.use_event(0)._offset == 188);
+            run_block(q, t, 512, 16);
+            nbr_fail += check("evq_carry_over", q.get_nbr_events(),
+                kept_flag && t.equals("r0+50 e0 r50+462 r0+188 e1 r188+324 "));
+        }
+
+        /* the coalescing stops at the block end: an event at n, or just
+           past it, belongs to the next block */
+        {
+            rspl::EventQueue<8> q;
+            Trace t;
+            q.push(make_event(510, 0));
+            q.push(make_event(512, 1));
+            q.push(make_event(515, 2));
+            run_block(q, t, 512, 16);
+            const bool kept_flag = (q.get_nbr_events() == 2
+                && q.use_event(0)._offset == 0 && q.use_event(1)._offset == 3);
+            run_block(q, t, 512, 16);
+            nbr_fail += check("evq_block_end", q.get_nbr_events(),
+                kept_flag && t.equals("r0+510 e0 r510+2 e1 e2 r0+512 "));
+        }
+
+        /* flush applies everything at once */
+        {
+            rspl::EventQueue<8> q;
+            Trace t;
+            q.push(make_event(300, 0));
+            q.push(make_event(2, 1));
+            q.flush([&t](const rspl::TimedEvent& e) { t.apply(e); });
+            nbr_fail += check("evq_flush", q.get_nbr_events(),
+                t.equals("e1 e0 ") && q.get_nbr_events() == 0);
+        }
+
+        return nbr_fail;
+    }
+
+    /*------------------------------ VoiceAlloc -----------------------------*/
+    const int ATTACK_LEN = 4;
+    const int RELEASE_LEN = 10;
+    const int STEAL_LEN = 2;
+
+    /* runs every active voice through nbr_spl samples, like the node */
+    template <int NV>
+    void run_voices(rspl::VoiceAlloc<NV>& va, int nbr_spl, int& nbr_restart)
+    {
+        for (int v = 0; v < NV; ++v)
+        {
+            int pos = 0;
+            while (pos < nbr_spl && va.use_slot(v).is_active()
+                && va.use_slot(v)._stage != rspl::VoiceSlot::Stage_SUSTAIN)
+            {
+                const int len = std::min(nbr_spl - pos, va.use_slot(v)._env_left);
+                if (va.advance(v, len))
+                {
+                    ++nbr_restart;
+                }
+                pos += len;
+            }
+        }
+    }
+
+    int test_voice_alloc()
+    {
+        int nbr_fail = 0;
+        int nbr_restart = 0;
+
+        rspl::VoiceAlloc<3> va;
+        va.set_ramp_len(ATTACK_LEN, RELEASE_LEN, STEAL_LEN);
+
+        /* free voices in order, attack then sustain */
+        const int v0 = va.note_on(60, 0.5f);
+        const int v1 = va.note_on(62, 0.5f);
+        const int v2 = va.note_on(64, 0.5f);
+        nbr_fail += check("va_free_first", v2, v0 == 0 && v1 == 1 && v2 == 2);
+        run_voices(va, ATTACK_LEN, nbr_restart);
+        const rspl::VoiceSlot& s0 = va.use_slot(0);
+        nbr_fail += check("va_attack_to_sustain", s0._stage,
+            s0._stage == rspl::VoiceSlot::Stage_SUSTAIN && s0._env == 1.0f);
+
+        /* all busy, none releasing: the oldest fades for the new note */
+        int v = va.note_on(67, 0.8f);
+        nbr_fail += check("va_steal_oldest", v,
+            v < 0 && s0._pending_note == 67 && s0._stage == rspl::VoiceSlot::Stage_RELEASE
+            && s0._env_left == STEAL_LEN);
+        run_voices(va, STEAL_LEN, nbr_restart);
+        nbr_fail += check("va_pending_starts", nbr_restart,
+            nbr_restart == 1 && s0._note == 67 && s0._stage == rspl::VoiceSlot::Stage_ATTACK
+            && s0._pending_note < 0);
+        run_voices(va, ATTACK_LEN, nbr_restart);
+
+        /* the quietest releasing voice goes before the oldest one */
+        va.note_off(62);
+        va.note_off(64);
+        run_voices(va, 3, nbr_restart);
+        va.note_off(67);
+        v = va.note_on(69, 1.0f);
+        nbr_fail += check("va_steal_quietest", v,
+            v < 0 && va.use_slot(1)._pending_note == 69 && va.use_slot(2)._pending_note < 0);
+
+        /* a note off for the pending note cancels it; the voice ends */
+        va.note_off(69);
+        run_voices(va, RELEASE_LEN, nbr_restart);
+        nbr_fail += check("va_pending_cancelled", nbr_restart,
+            nbr_restart == 1 && !va.is_any_active());
+
+        /* a held note played again restarts its own voice */
+        va.kill_all();
+        va.note_on(60, 0.5f);
+        va.note_on(62, 0.5f);
+        run_voices(va, ATTACK_LEN, nbr_restart);
+        v = va.note_on(62, 0.9f);
+        nbr_fail += check("va_retrigger", v,
+            v < 0 && va.use_slot(1)._pending_note == 62 && va.use_slot(2).is_active() == false);
+
+        /* every voice fading for a pending note: the oldest is replaced */
+        va.kill_all();
+        va.note_on(60, 0.5f);
+        va.note_on(62, 0.5f);
+        va.note_on(64, 0.5f);
+        va.note_on(65, 0.5f);
+        va.note_on(67, 0.5f);
+        va.note_on(69, 0.5f);
+        v = va.note_on(71, 0.5f);
+        nbr_fail += check("va_replace_pending", v,
+            v < 0 && va.use_slot(0)._pending_note == 71
+            && va.use_slot(1)._pending_note == 67 && va.use_slot(2)._pending_note == 69);
+
+        return nbr_fail;
+    }
+
+    /*----------------------------- ParamHandoff ----------------------------*/
+    /* the node's parameter path: slots at the start of the block, queued
+       changes through the event queue, accept() when they are applied */
+    class ParamNode
+    {
+    public:
+        typedef rspl::ParamHandoff<2, 4> Handoff;
+
+        ParamNode() { _val_arr[0] = 0; _val_arr[1] = 0; }
+
+        void apply(int index, float val) { _val_arr[index] = val; }
+
+        void process(int nbr_spl)
+        {
+            _handoff.pull_slots([this](int i, float v) { apply(i, v); });
+            Handoff::Change c;
+            while (_handoff.pop(c))
+            {
+                const rspl::TimedEvent e = { c._offset, rspl::TimedEvent::Type_PARAM, c._index, c._val, c._seq };
+                _queue.push(e);
+            }
+            _queue.process_block(nbr_spl, 16,
+                [this](const rspl::TimedEvent& e)
+                {
+                    if (_handoff.accept(e._index, e._seq))
+                    {
+                        apply(e._index, e._val);
+                    }
+                },
+                [](int, int) {});
+        }
+
+        Handoff             _handoff;
+        rspl::EventQueue<8> _queue;
+        float               _val_arr[2];
+    };
+
+    int to_milli(float val) { return static_cast<int>(val * 1000 + 0.5f); }
+
+    int test_param_handoff()
+    {
+        int nbr_fail = 0;
+
+        /* queued then immediate, same block: the queued one is dropped */
+        {
+            ParamNode node;
+            node._handoff.set_at(0, 0.1f, 32);
+            node._handoff.set(0, 0.9f);
+            node.process(512);
+            nbr_fail += check("ph_older_queued_dropped", to_milli(node._val_arr[0]), to_milli(node._val_arr[0]) == 900);
+        }
+
+        /* immediate then queued: the queued one lands at its offset */
+        {
+            ParamNode node;
+            node._handoff.set(0, 0.2f);
+            node._handoff.set_at(0, 0.7f, 32);
+            node.process(512);
+            nbr_fail += check("ph_newer_queued_kept", to_milli(node._val_arr[0]), to_milli(node._val_arr[0]) == 700);
+        }
+
+        /* a queued change for the next block, overtaken by a slot write
+           before that block: the carried event must not land on top */
+        {
+            ParamNode node;
+            node._handoff.set_at(0, 0.1f, 700);
+            node.process(512);
+            const bool carried_flag = (node._queue.get_nbr_events() == 1 && node._val_arr[0] == 0);
+            node._handoff.set(0, 0.9f);
+            node.process(512);
+            nbr_fail += check("ph_slot_after_carried", to_milli(node._val_arr[0]),
+                carried_flag && to_milli(node._val_arr[0]) == 900);
+        }
+
+        /* the other parameter is independent */
+        {
+            ParamNode node;
+            node._handoff.set_at(1, 0.3f, 700);
+            node._handoff.set(0, 0.9f);
+            node.process(512);
+            node.process(512);
+            nbr_fail += check("ph_per_parameter", to_milli(node._val_arr[1]),
+                to_milli(node._val_arr[0]) == 900 && to_milli(node._val_arr[1]) == 300);
+        }
+
+        /* a full queue hands the change to the slot, still numbered */
+        {
+            ParamNode node;
+            for (int i = 0; i < 5; ++i)
+            {
+                node._handoff.set_at(0, 0.1f * static_cast<float>(i + 1), 700);
+            }
+            node.process(512);
+            const int slot_val = to_milli(node._val_arr[0]);
+            node.process(512);
+            nbr_fail += check("ph_queue_full", to_milli(node._val_arr[0]),
+                slot_val == 500 && to_milli(node._val_arr[0]) == 500);
+        }
+
+        return nbr_fail;
+    }
+
+    /*----------------------------- FrameStore ------------------------------*/
+    const long FS_CYCLE_LEN = 16;
+    const long FS_PAD_LEN = 8;
+
+    void fill_frame(std::vector<float>& src, int frame, int shape, float offset)
+    {
+        for (long i = 0; i < FS_CYCLE_LEN; ++i)
+        {
+            const float ph = static_cast<float>(i) / FS_CYCLE_LEN;
+            const float val = (shape == 0) ? 2 * ph - 1 : (ph < 0.5f ? 0.5f : -0.5f);
+            src[frame * FS_CYCLE_LEN + i] = val + offset;
+        }
+    }
+
+    /* largest distance between each frame and the padded slot its map
+       entry points to, pad included */
+    float frame_store_err(const rspl::FrameStore& store, const std::vector<float>& src)
+    {
+        const float* table_ptr = store.get_table();
+        const int* map_ptr = store.get_frame_map();
+        float err = 0;
+        for (int f = 0; f < store.get_nbr_frames(); ++f)
+        {
+            const float* slot_ptr = table_ptr + map_ptr[f] * store.get_frame_stride();
+            for (long i = 0; i < store.get_frame_stride(); ++i)
+            {
+                err = std::max(err, std::fabs(slot_ptr[i] - src[f * FS_CYCLE_LEN + i % FS_CYCLE_LEN]));
+            }
+        }
+        return err;
+    }
+
+    std::string map_string(const rspl::FrameStore& store)
+    {
+        std::string str;
+        for (int f = 0; f < store.get_nbr_frames(); ++f)
+        {
+            str += static_cast<char>('0' + store.get_frame_map()[f]);
+        }
+        return str;
+    }
+
+    int test_frame_store()
+    {
+        int nbr_fail = 0;
+
+        /* saw, square, saw, square + 0.001, saw, square */
+        const int nbr_frames = 6;
+        std::vector<float> src(nbr_frames * FS_CYCLE_LEN);
+        fill_frame(src, 0, 0, 0);
+        fill_frame(src, 1, 1, 0);
+        fill_frame(src, 2, 0, 0);
+        fill_frame(src, 3, 1, 0.001f);
+        fill_frame(src, 4, 0, 0);
+        fill_frame(src, 5, 1, 0);
+
+        rspl::FrameStore store;
+
+        /* tolerance 0: the near copy keeps its own slot */
+        store.build(&src[0], nbr_frames, FS_CYCLE_LEN, FS_PAD_LEN);
+        {
+            const float err = frame_store_err(store, src);
+            nbr_fail += check("fs_exact_frames", store.get_nbr_unique_frames(),
+                store.get_nbr_frames() == nbr_frames
+                && store.get_nbr_unique_frames() == 3
+                && store.get_frame_stride() == FS_CYCLE_LEN + FS_PAD_LEN
+                && store.get_table_len() == 3 * (FS_CYCLE_LEN + FS_PAD_LEN)
+                && map_string(store) == "010201"
+                && err == 0);
+        }
+
+        /* within tolerance of the previous stored frame: shares its slot,
+           the stored content stays the first frame's */
+        store.build(&src[0], nbr_frames, FS_CYCLE_LEN, FS_PAD_LEN, 0.01f);
+        {
+            const float* slot_ptr = store.get_table() + store.get_frame_stride();
+            const bool first_kept_flag =
+                (std::memcmp(slot_ptr, &src[1 * FS_CYCLE_LEN], sizeof(float) * FS_CYCLE_LEN) == 0);
+            const float err = frame_store_err(store, src);
+            nbr_fail += check("fs_tolerance_merge", store.get_nbr_unique_frames(),
+                store.get_nbr_unique_frames() == 2
+                && map_string(store) == "010101"
+                && first_kept_flag
+                && err <= 0.01f);
+        }
+
+        /* all identical: one stored frame */
+        for (int f = 0; f < nbr_frames; ++f)
+        {
+            fill_frame(src, f, 1, 0);
+        }
+        store.build(&src[0], nbr_frames, FS_CYCLE_LEN, FS_PAD_LEN);
+        {
+            const float err = frame_store_err(store, src);
+            nbr_fail += check("fs_all_identical", store.get_nbr_unique_frames(),
+                store.get_nbr_unique_frames() == 1
+                && store.get_table_len() == FS_CYCLE_LEN + FS_PAD_LEN
+                && map_string(store) == "000000"
+                && err == 0);
+        }
+
+        return nbr_fail;
+    }
+
+} // namespace
+
+int main()
+{
+    printf("check,value,status\n");
+    int nbr_fail = 0;
+    nbr_fail += test_spsc_queue();
+    nbr_fail += test_event_queue();
+    nbr_fail += test_voice_alloc();
+    nbr_fail += test_param_handoff();
+    nbr_fail += test_frame_store();
+
+    printf("%s\n", (nbr_fail == 0) ? "PASSED" : "FAILED");
+    return (nbr_fail == 0) ? 0 : 1;
+}
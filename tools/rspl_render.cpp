@@ -0,0 +1,636 @@
+/******************************************************************************
+    rspl_render.cpp - Headless offline renderer for the wavetable engine
+    No JUCE/HISE dependency. Builds a table (generated, or loaded from a
+    WAV file of back-to-back single cycles), runs a note script through
+    the same engine layout as Griffin_WT (ResamplerFlt voices on a shared
+    MixBusFlt, allocated and stolen by VoiceAlloc), writes the result to
+    a mono 32-bit float WAV file and prints the render throughput.
+
+        rspl_render [options]
+          -o file.wav     output (default rspl_render.wav)
+          -t file.wav     load the table; channel 0, any PCM/float format
+          -c len          cycle length of the loaded table (default 2048)
+          -f frames       frames of the generated table (default 64)
+          -s script.txt   note script (default: a built-in demo)
+          -r rate         sample rate (default 48000)
+          -b block        block length (default 256)
+          -n repeat       render the script n times, for profiling
+
+    Script: one event per line, "#" starts a comment, times in seconds.
+
+        <time> on <note> <velocity 0..1>
+        <time> off <note>
+        <time> pitch <semitones>          global bend
+        <time> frame <position 0..1>      across the whole table
+        <time> end
+
+    Build from the repository root:
+
+        g++ -O2 -I. tools/rspl_render.cpp rspl_big_arrays.cpp -o rspl_render
+******************************************************************************/
+
+#include "rspl_cycleresample.h"
+#include "rspl_framestore.h"
+#include "rspl_resamplerflt.h"
+#include "rspl_mixbus.h"
+#include "rspl_stopwatch.h"
+#include "rspl_voicealloc.h"
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+
+    const long BASE_CYCLE_LEN = rspl::ResamplerFlt::BASE_CYCLE_LEN;
+    const int  NBR_LEVELS = 12;
+    const int  NBR_VOICES = 16;
+    const double ATTACK_S = 0.001;
+    const double RELEASE_S = 0.010;
+    const double STEAL_S = 0.002;
+
+    /*------------------------------- WAV I/O -------------------------------*/
+    unsigned long read_le(const unsigned char* p, int nbr_bytes)
+    {
+        unsigned long val = 0;
+        for (int i = nbr_bytes - 1; i >= 0; --i)
+        {
+            val = (val << 8) | p[i];
+        }
+        return val;
+    }
+
+    void write_le(FILE* f_ptr, unsigned long val, int nbr_bytes)
+    {
+        for (int i = 0; i < nbr_bytes; ++i)
+        {
+            fputc(static_cast<int>((val >> (i * 8)) & 0xFF), f_ptr);
+        }
+    }
+
+    /* first channel of a PCM 8/16/24/32 or float 32/64 file */
+    bool read_wav(const char* path_0, std::vector<float>& data)
+    {
+        FILE* f_ptr = fopen(path_0, "rb");
+        if (f_ptr == 0)
+        {
+            return false;
+        }
+        std::vector<unsigned char> file;
+        unsigned char buf[65536];
+        size_t len;
+        while ((len = fread(buf, 1, sizeof(buf), f_ptr)) > 0)
+        {
+            file.insert(file.end(), buf, buf + len);
+        }
+        fclose(f_ptr);
+
+        if (file.size() < 12 || memcmp(&file[0], "RIFF", 4) != 0 || memcmp(&file[8], "WAVE", 4) != 0)
+        {
+            return false;
+        }
+        int fmt_tag = 0;
+        int nbr_chn = 0;
+        int nbr_bits = 0;
+        size_t pos = 12;
+        while (pos + 8 <= file.size())
+        {
+            const unsigned char* chunk_ptr = &file[pos];
+            const size_t chunk_len = read_le(chunk_ptr + 4, 4);
+            const size_t avail = std::min(chunk_len, file.size() - pos - 8);
+            if (memcmp(chunk_ptr, "fmt ", 4) == 0 && avail >= 16)
+            {
+                fmt_tag = static_cast<int>(read_le(chunk_ptr + 8, 2));
+                nbr_chn = static_cast<int>(read_le(chunk_ptr + 10, 2));
+                nbr_bits = static_cast<int>(read_le(chunk_ptr + 22, 2));
+                if (fmt_tag == 0xFFFE && avail >= 26)
+                {
+                    fmt_tag = static_cast<int>(read_le(chunk_ptr + 32, 2));   // WAVE_FORMAT_EXTENSIBLE
+                }
+            }
+            else if (memcmp(chunk_ptr, "data", 4) == 0 && nbr_chn > 0 && nbr_bits > 0)
+            {
+                const int frame_bytes = nbr_chn * nbr_bits / 8;
+                const long nbr_spl = static_cast<long>(avail / frame_bytes);
+                data.resize(nbr_spl);
+                for (long i = 0; i < nbr_spl; ++i)
+                {
+                    const unsigned char* s_ptr = chunk_ptr + 8 + i * frame_bytes;
+                    if (fmt_tag == 3 && nbr_bits == 32)
+                    {
+                        float v;
+                        memcpy(&v, s_ptr, 4);
+                        data[i] = v;
+                    }
+                    else if (fmt_tag == 3 && nbr_bits == 64)
+                    {
+                        double v;
+                        memcpy(&v, s_ptr, 8);
+                        data[i] = static_cast<float>(v);
+                    }
+                    else if (fmt_tag == 1 && nbr_bits == 8)
+                    {
+                        data[i] = (s_ptr[0] - 128) / 128.0f;
+                    }
+                    else if (fmt_tag == 1 && nbr_bits >= 16 && nbr_bits <= 32)
+                    {
+                        const int nbr_bytes = nbr_bits / 8;
+                        const unsigned long u = read_le(s_ptr, nbr_bytes) << (32 - nbr_bits);
+                        const int32_t v = static_cast<int32_t>(static_cast<uint32_t>(u));
+                        data[i] = static_cast<float>(v / 2147483648.0);
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            pos += 8 + chunk_len + (chunk_len & 1);
+        }
+        return false;
+    }
+
+    bool write_wav(const char* path_0, const std::vector<float>& data, long rate)
+    {
+        FILE* f_ptr = fopen(path_0, "wb");
+        if (f_ptr == 0)
+        {
+            return false;
+        }
+        const unsigned long data_len = static_cast<unsigned long>(data.size() * sizeof(float));
+        fwrite("RIFF", 1, 4, f_ptr);
+        write_le(f_ptr, 36 + data_len, 4);
+        fwrite("WAVEfmt ", 1, 8, f_ptr);
+        write_le(f_ptr, 16, 4);
+        write_le(f_ptr, 3, 2);              // IEEE float
+        write_le(f_ptr, 1, 2);              // mono
+        write_le(f_ptr, rate, 4);
+        write_le(f_ptr, rate * 4, 4);
+        write_le(f_ptr, 4, 2);
+        write_le(f_ptr, 32, 2);
+        fwrite("data", 1, 4, f_ptr);
+        write_le(f_ptr, data_len, 4);
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            unsigned char b[4];
+            memcpy(b, &data[i], 4);
+            write_le(f_ptr, read_le(b, 4), 4);
+        }
+        const bool ok_flag = (ferror(f_ptr) == 0);
+        fclose(f_ptr);
+        return ok_flag;
+    }
+
+    /*-------------------------------- table --------------------------------*/
+    /* saw-to-sine morph, one cycle per frame */
+    void generate_table(std::vector<float>& raw, int nbr_frames)
+    {
+        raw.resize(nbr_frames * BASE_CYCLE_LEN);
+        for (int f = 0; f < nbr_frames; ++f)
+        {
+            const double mix = static_cast<double>(f) / std::max(1, nbr_frames - 1);
+            for (long s = 0; s < BASE_CYCLE_LEN; ++s)
+            {
+                const double ph = static_cast<double>(s) / BASE_CYCLE_LEN;
+                const double saw = 2 * ph - 1;
+                const double sine = sin(2 * rspl::PI * ph);
+                raw[f * BASE_CYCLE_LEN + s] = static_cast<float>(0.8 * ((1 - mix) * saw + mix * sine));
+            }
+        }
+    }
+
+    /* cycles of any length to BASE_CYCLE_LEN, with the resampler
+       Griffin_WT loads files with */
+    void load_table(std::vector<float>& raw, const std::vector<float>& data, long cycle_len)
+    {
+        const long nbr_frames = static_cast<long>(data.size()) / cycle_len;
+        raw.resize(nbr_frames * BASE_CYCLE_LEN);
+        for (long f = 0; f < nbr_frames; ++f)
+        {
+            rspl::resample_cycle(&data[f * cycle_len], cycle_len, &raw[f * BASE_CYCLE_LEN], BASE_CYCLE_LEN);
+        }
+    }
+
+    /*-------------------------------- script -------------------------------*/
+    enum EventType { EventType_ON = 0, EventType_OFF, EventType_PITCH, EventType_FRAME, EventType_END };
+
+    class Event
+    {
+    public:
+        long        _time;      // samples
+        EventType   _type;
+        int         _note;
+        double      _value;
+    };
+
+    const char* const DEMO_SCRIPT =
+        "0.00 frame 0\n"
+        "0.00 on 48 0.8\n"
+        "0.50 on 55 0.7\n"
+        "1.00 on 60 0.7\n"
+        "1.00 frame 0.5\n"
+        "1.50 on 64 0.6\n"
+        "2.00 pitch 7\n"
+        "2.50 frame 1\n"
+        "3.00 pitch -12\n"
+        "3.50 off 48\n"
+        "3.50 off 55\n"
+        "3.50 on 84 0.5\n"
+        "4.00 pitch 24\n"
+        "4.50 off 60\n"
+        "4.50 off 64\n"
+        "4.50 off 84\n"
+        "5.00 end\n";
+
+    bool parse_script(const std::string& text, long rate, std::vector<Event>& evt_arr)
+    {
+        evt_arr.clear();
+        size_t pos = 0;
+        int line_nbr = 0;
+        while (pos < text.size())
+        {
+            size_t end = text.find('\n', pos);
+            if (end == std::string::npos)
+            {
+                end = text.size();
+            }
+            std::string line = text.substr(pos, end - pos);
+            pos = end + 1;
+            ++line_nbr;
+            const size_t hash = line.find('#');
+            if (hash != std::string::npos)
+            {
+                line.resize(hash);
+            }
+
+            double time_s;
+            char cmd[32];
+            double a = 0;
+            double b = 0;
+            const int nbr_fields = sscanf(line.c_str(), "%lf %31s %lf %lf", &time_s, cmd, &a, &b);
+            if (nbr_fields <= 0)
+            {
+                continue;
+            }
+            Event e;
+            e._time = static_cast<long>(floor(time_s * rate + 0.5));
+            e._note = 0;
+            e._value = 0;
+            bool ok_flag = (nbr_fields >= 2 && time_s >= 0);
+            if (ok_flag && strcmp(cmd, "on") == 0)
+            {
+                e._type = EventType_ON;
+                e._note = static_cast<int>(a);
+                e._value = b;
+                ok_flag = (nbr_fields == 4);
+            }
+            else if (ok_flag && strcmp(cmd, "off") == 0)
+            {
+                e._type = EventType_OFF;
+                e._note = static_cast<int>(a);
+                ok_flag = (nbr_fields == 3);
+            }
+            else if (ok_flag && strcmp(cmd, "pitch") == 0)
+            {
+                e._type = EventType_PITCH;
+                e._value = a;
+                ok_flag = (nbr_fields == 3);
+            }
+            else if (ok_flag && strcmp(cmd, "frame") == 0)
+            {
+                e._type = EventType_FRAME;
+                e._value = std::max(0.0, std::min(a, 1.0));
+                ok_flag = (nbr_fields == 3);
+            }
+            else if (ok_flag && strcmp(cmd, "end") == 0)
+            {
+                e._type = EventType_END;
+            }
+            else
+            {
+                ok_flag = false;
+            }
+            if (!ok_flag)
+            {
+                fprintf(stderr, "script line %d: cannot parse \"%s\"\n", line_nbr, line.c_str());
+                return false;
+            }
+            evt_arr.push_back(e);
+        }
+
+        std::stable_sort(evt_arr.begin(), evt_arr.end(),
+            [](const Event& x, const Event& y) { return x._time < y._time; });
+        if (evt_arr.empty() || evt_arr.back()._type != EventType_END)
+        {
+            fprintf(stderr, "script: missing \"end\"\n");
+            return false;
+        }
+        return true;
+    }
+
+    /*-------------------------------- engine -------------------------------*/
+    /* Voice allocation, envelopes and stealing are Griffin_WT's: a free
+       voice, else the quietest releasing one, else the oldest, faded out
+       over STEAL_S before the new note starts on it. */
+    class Engine
+    {
+    public:
+        Engine(const rspl::FrameStore& store, const rspl::MipMapFlt& mip_map, long rate, long block)
+            : _store(store), _pack(), _bus(), _alloc(), _rate(rate), _bend(0), _frame_pos(0)
+        {
+            _bus.set_max_block_len(block);
+            for (rspl::ResamplerFlt& r : _rspl_arr)
+            {
+                r.set_sample(mip_map);
+                r.set_interp(_pack);
+                r.set_frame_layout(store.get_frame_stride(), store.get_nbr_frames(), store.get_frame_map());
+            }
+            _alloc.set_ramp_len(to_spl(ATTACK_S), to_spl(RELEASE_S), to_spl(STEAL_S));
+        }
+
+        void apply(const Event& e)
+        {
+            switch (e._type)
+            {
+            case EventType_ON:     note_on(e._note, static_cast<float>(e._value)); break;
+            case EventType_OFF:    _alloc.note_off(e._note); break;
+            case EventType_PITCH:  _bend = e._value; update_pitch(); break;
+            case EventType_FRAME:  _frame_pos = e._value * (_store.get_nbr_frames() - 1); update_frame(); break;
+            case EventType_END:    break;
+            }
+        }
+
+        void render(float dest_ptr[], long nbr_spl)
+        {
+            float* bus_ptr = _bus.begin_block(nbr_spl);
+            for (int v = 0; v < NBR_VOICES; ++v)
+            {
+                if (_alloc.use_slot(v).is_active())
+                {
+                    render_voice(v, bus_ptr, nbr_spl);
+                }
+            }
+            _bus.end_block(dest_ptr, nbr_spl);
+        }
+
+    private:
+        long to_pitch(int note) const
+        {
+            const double freq = 440 * pow(2.0, (note + _bend - 69) / 12.0);
+            const double pitch_oct = log(freq * BASE_CYCLE_LEN / _rate) / log(2.0);
+            const double max_oct = NBR_LEVELS - 0.01;
+            return static_cast<long>(std::min(pitch_oct, max_oct) * (1L << rspl::ResamplerFlt::NBR_BITS_PER_OCT));
+        }
+
+        int to_spl(double dur_s) const
+        {
+            return std::max(1, static_cast<int>(dur_s * _rate));
+        }
+
+        void note_on(int note, float vel)
+        {
+            const int v = _alloc.note_on(note, vel * 0.25f);
+            if (v >= 0)
+            {
+                start_voice(v);
+            }
+        }
+
+        /* the allocator has set up the note and its attack */
+        void start_voice(int v)
+        {
+            rspl::ResamplerFlt& r = _rspl_arr[v];
+            r.clear_buffers();
+            r.set_playback_pos(0);
+            r.set_pitch(to_pitch(_alloc.use_slot(v)._note));
+            r.set_frame_pos(static_cast<float>(_frame_pos));
+        }
+
+        void update_pitch()
+        {
+            for (int v = 0; v < NBR_VOICES; ++v)
+            {
+                const rspl::VoiceSlot& s = _alloc.use_slot(v);
+                if (s.is_active()) { _rspl_arr[v].set_pitch(to_pitch(s._note)); }
+            }
+        }
+
+        void update_frame()
+        {
+            for (int v = 0; v < NBR_VOICES; ++v)
+            {
+                if (_alloc.use_slot(v).is_active()) { _rspl_arr[v].set_frame_pos(static_cast<float>(_frame_pos)); }
+            }
+        }
+
+        /* envelope segments are linear, split where a ramp ends */
+        void render_voice(int v, float bus_ptr[], long nbr_spl)
+        {
+            const rspl::VoiceSlot& s = _alloc.use_slot(v);
+            rspl::ResamplerFlt& r = _rspl_arr[v];
+            long pos = 0;
+            while (pos < nbr_spl && s.is_active())
+            {
+                const float g = s._gain;
+                if (s._stage == rspl::VoiceSlot::Stage_SUSTAIN)
+                {
+                    r.interpolate_block_add_2x(bus_ptr + pos * 2, nbr_spl - pos, g, 0);
+                    return;
+                }
+                const long work = std::min(nbr_spl - pos, static_cast<long>(s._env_left));
+                r.interpolate_block_add_2x(bus_ptr + pos * 2, work, g * s._env, g * s._env_step);
+                pos += work;
+                if (_alloc.advance(v, static_cast<int>(work)))
+                {
+                    start_voice(v);
+                }
+            }
+        }
+
+        const rspl::FrameStore& _store;
+        rspl::InterpPack    _pack;
+        rspl::MixBusFlt     _bus;
+        rspl::ResamplerFlt  _rspl_arr[NBR_VOICES];
+        rspl::VoiceAlloc<NBR_VOICES>
+                            _alloc;
+        double              _rate;
+        double              _bend;
+        double              _frame_pos;
+    };
+
+    /* events apply at their sample; blocks are split at event times */
+    void render_script(std::vector<float>& out, const std::vector<Event>& evt_arr, Engine& engine, long block)
+    {
+        const long len = evt_arr.back()._time;
+        const long base = static_cast<long>(out.size());
+        out.resize(base + len);
+        size_t next = 0;
+        long pos = 0;
+        while (pos < len)
+        {
+            while (next < evt_arr.size() && evt_arr[next]._time <= pos)
+            {
+                engine.apply(evt_arr[next++]);
+            }
+            long work = std::min(block, len - pos);
+            if (next < evt_arr.size())
+            {
+                work = std::min(work, evt_arr[next]._time - pos);
+            }
+            engine.render(&out[base + pos], work);
+            pos += work;
+        }
+    }
+
+    bool read_text(const char* path_0, std::string& text)
+    {
+        FILE* f_ptr = fopen(path_0, "rb");
+        if (f_ptr == 0)
+        {
+            return false;
+        }
+        char buf[4096];
+        size_t len;
+        while ((len = fread(buf, 1, sizeof(buf), f_ptr)) > 0)
+        {
+            text.append(buf, len);
+        }
+        fclose(f_ptr);
+        return true;
+    }
+
+    int usage(const char* name_0)
+    {
+        fprintf(stderr,
+            "usage: %s [-o out.wav] [-t table.wav] [-c cycle_len] [-f frames]\n"
+            "          [-s script.txt] [-r rate] [-b block] [-n repeat]\n", name_0);
+        return 2;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const char* out_path_0 = "rspl_render.wav";
+    const char* table_path_0 = 0;
+    const char* script_path_0 = 0;
+    long cycle_len = BASE_CYCLE_LEN;
+    int  nbr_frames = 64;
+    long rate = 48000;
+    long block = 256;
+    int  nbr_repeats = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* opt = argv[i];
+        if (i + 1 >= argc || opt[0] != '-' || opt[1] == '\0' || opt[2] != '\0')
+        {
+            return usage(argv[0]);
+        }
+        const char* val = argv[++i];
+        switch (opt[1])
+        {
+        case 'o': out_path_0 = val; break;
+        case 't': table_path_0 = val; break;
+        case 'c': cycle_len = atol(val); break;
+        case 'f': nbr_frames = atoi(val); break;
+        case 's': script_path_0 = val; break;
+        case 'r': rate = atol(val); break;
+        case 'b': block = atol(val); break;
+        case 'n': nbr_repeats = atoi(val); break;
+        default:  return usage(argv[0]);
+        }
+    }
+    if (cycle_len <= 1 || nbr_frames <= 0 || rate <= 0 || block <= 0 || nbr_repeats <= 0)
+    {
+        return usage(argv[0]);
+    }
+
+    /* table */
+    rspl::StopWatch sw;
+    sw.start();
+    std::vector<float> raw;
+    if (table_path_0 != 0)
+    {
+        std::vector<float> data;
+        if (!read_wav(table_path_0, data) || static_cast<long>(data.size()) < cycle_len)
+        {
+            fprintf(stderr, "cannot load a table from %s\n", table_path_0);
+            return 1;
+        }
+        load_table(raw, data, cycle_len);
+    }
+    else
+    {
+        generate_table(raw, nbr_frames);
+    }
+    const int nbr_raw_frames = static_cast<int>(raw.size() / BASE_CYCLE_LEN);
+
+    rspl::FrameStore store;
+    rspl::MipMapFlt  mip_map;
+    store.build(&raw[0], nbr_raw_frames, BASE_CYCLE_LEN, BASE_CYCLE_LEN / 2);
+    mip_map.init_sample(
+        store.get_table_len(),
+        rspl::InterpPack::get_len_pre(),
+        rspl::InterpPack::get_len_post(),
+        NBR_LEVELS,
+        rspl::MIP_MAP_FIR_COEF_ARR,
+        rspl::ResamplerFlt::MIP_MAP_FIR_LEN);
+    mip_map.fill_sample(store.get_table(), store.get_table_len());
+    sw.stop();
+    const double build_ms = sw.get_ns() * 1e-6;
+
+    /* script */
+    std::string text;
+    if (script_path_0 != 0)
+    {
+        if (!read_text(script_path_0, text))
+        {
+            fprintf(stderr, "cannot read %s\n", script_path_0);
+            return 1;
+        }
+    }
+    else
+    {
+        text = DEMO_SCRIPT;
+    }
+    std::vector<Event> evt_arr;
+    if (!parse_script(text, rate, evt_arr))
+    {
+        return 1;
+    }
+
+    /* render */
+    std::vector<float> out;
+    out.reserve(evt_arr.back()._time * nbr_repeats);
+    sw.start();
+    for (int r = 0; r < nbr_repeats; ++r)
+    {
+        Engine engine(store, mip_map, rate, block);
+        render_script(out, evt_arr, engine, block);
+    }
+    sw.stop();
+    const double render_s = sw.get_ns() * 1e-9;
+
+    if (!write_wav(out_path_0, out, rate))
+    {
+        fprintf(stderr, "cannot write %s\n", out_path_0);
+        return 1;
+    }
+
+    const double audio_s = static_cast<double>(out.size()) / rate;
+    printf("table: %d frames, %d unique, built in %.2f ms\n",
+        store.get_nbr_frames(), store.get_nbr_unique_frames(), build_ms);
+    printf("render: %.3f s of audio in %.3f s, %.0fx real time, %.2f Msamples/s\n",
+        audio_s, render_s, audio_s / std::max(render_s, 1e-9), out.size() / std::max(render_s, 1e-9) * 1e-6);
+    printf("wrote %s\n", out_path_0);
+
+    return 0;
+}